@@ -0,0 +1,71 @@
+#include <cstdlib>
+#include <memory>
+#include <dlfcn.h>
+#include <json/json.hpp>
+#include <SDL.h>
+
+#include <Entity.h>
+#include <AppManager.h>
+#include <TransformComponent.h>
+#include <ResManager.h>
+#include <SpriteRes.h>
+#include <SpriteResFactory.h>
+#include <TextureRes.h>
+#include <StdFileMonitorManager.h>
+#include <ResRepositoryManager.h>
+#include <StdFileLoadManager.h>
+#include <DefaultResFactory.h>
+#include <TextResFactory.h>
+#include <DesktopThread.h>
+#include <PosixApplication.h>
+#include <AtlasResFactory.h>
+#include <SceneManager.h>
+#include <Sdl2Manager.h>
+#include <GLRenderManager.h>
+#include <GLRenderElementFactory.h>
+#include <ScreenManager.h>
+#include <ThreadManager.h>
+#include <ProjectManager.h>
+
+#include "EditorApp.h"
+#include "SceneBatch.h"
+
+using namespace flappy;
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        std::cout << "Pass dynamic library of a project as argument." << std::endl;
+        std::cout << "Batch: <project> --batch <report.json> [--canonical | --binary] [--out <dir>] [--library <lib>] <scene>..." << std::endl;
+        return 10;
+    }
+
+    // Headless, runs without a window and exits
+    if (argc >= 4 && std::string(argv[2]) == "--batch") {
+        SceneBatch::Options batchOptions;
+        batchOptions.reportPath = argv[3];
+        for (int i = 4; i < argc; i++) {
+            std::string argument = argv[i];
+            if (argument == "--canonical")
+                batchOptions.output = SceneBatch::Output::Canonical;
+            else if (argument == "--binary")
+                batchOptions.output = SceneBatch::Output::Binary;
+            else if ((argument == "--out" || argument == "--library") && i + 1 == argc) {
+                std::cout << argument << " expects a path." << std::endl;
+                return 10;
+            } else if (argument == "--out")
+                batchOptions.outputDirectory = argv[++i];
+            else if (argument == "--library")
+                batchOptions.libraryPath = argv[++i];
+            else
+                batchOptions.scenePaths.push_back(argument);
+        }
+        return SceneBatch(argv[1], batchOptions).run();
+    }
+
+    PosixApplication application;
+    auto currentThread = std::make_shared<DesktopThread>([argv](SafePtr<Entity> rootEntity) {
+        createEditor(rootEntity, argv[1]);
+    });
+    return application.runThread(currentThread);
+}
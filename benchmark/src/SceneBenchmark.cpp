@@ -0,0 +1,408 @@
+#include "SceneBenchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <Entity.h>
+#include <IFileLoadManager.h>
+
+#include "EditorManager.h"
+#include "ProjectManager.h"
+#include "ThreadPool.h"
+
+using namespace flappy;
+using json = nlohmann::json;
+
+// Allocation counters of the whole process. Allocations are counted only
+// while a benchmark measures a call, outside of it the replaced operators
+// cost a single relaxed load.
+
+static std::atomic<bool> countingAllocations {false};
+static std::atomic<uint64_t> allocationCount {0};
+static std::atomic<uint64_t> allocatedBytes {0};
+
+static void* allocate(std::size_t size) noexcept {
+    if (countingAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(std::size_t size) {
+    if (auto ptr = allocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (auto ptr = allocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+#ifdef __cpp_aligned_new
+static void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept {
+    if (countingAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    void* ptr = nullptr;
+    auto alignmentSize = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+    return posix_memalign(&ptr, alignmentSize, size == 0 ? 1 : size) == 0 ? ptr : nullptr;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (auto ptr = allocateAligned(size, alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (auto ptr = allocateAligned(size, alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+#endif
+
+static long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static json generateEntity(size_t index) {
+    json components = json::array();
+    components.push_back({{"type", "flappy::TransformComponent"}});
+    auto textComponent = json {{"type", "flappy::TextComponent"}, {"fontResPath", "irohamaru-mikami-Medium"}, {"text", "Entity " + std::to_string(index)}};
+    switch (index % 4) {
+    case 0:
+        components.push_back({{"type", "flappy::InternalComponent"}, {"value", static_cast<int>(index)}});
+        break;
+    case 1:
+        components.push_back(textComponent);
+        break;
+    case 2:
+        // The set of TestScene.scene
+        components.push_back({{"type", "flappy::InternalComponent"}, {"value", -static_cast<int>(index)}});
+        components.push_back({{"type", "flappy::OtherInternalComponent"}});
+        components.push_back(textComponent);
+        break;
+    default:
+        break;
+    }
+    return {{"components", components}};
+}
+
+static void generateChildren(json& jsonEntity, size_t depth, size_t branching, size_t& remaining) {
+    if (depth == 0)
+        return;
+    auto jsonEntities = json::array();
+    for (size_t i = 0; i < branching && remaining > 0; ++i) {
+        auto jsonChild = generateEntity(remaining--);
+        generateChildren(jsonChild, depth - 1, branching, remaining);
+        jsonEntities.push_back(std::move(jsonChild));
+    }
+    if (!jsonEntities.empty())
+        jsonEntity["entities"] = std::move(jsonEntities);
+}
+
+json SceneBenchmark::generateScene(size_t entityCount, size_t depth) {
+    depth = std::max<size_t>(depth, 1);
+    auto branching = std::max<size_t>(2, static_cast<size_t>(std::ceil(std::pow(entityCount, 1.0 / depth))));
+    size_t remaining = entityCount;
+    auto jsonEntities = json::array();
+    while (remaining > 0) {
+        auto jsonChild = generateEntity(remaining--);
+        generateChildren(jsonChild, depth - 1, branching, remaining);
+        jsonEntities.push_back(std::move(jsonChild));
+    }
+    return {{"entities", jsonEntities}};
+}
+
+static size_t componentCount(const json& jsonEntity) {
+    size_t count = 0;
+    auto componentsIter = jsonEntity.find("components");
+    if (componentsIter != jsonEntity.end())
+        count += componentsIter->size();
+    auto entitiesIter = jsonEntity.find("entities");
+    if (entitiesIter != jsonEntity.end()) {
+        for (const auto& jsonChild : *entitiesIter)
+            count += componentCount(jsonChild);
+    }
+    return count;
+}
+
+static void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream stream(path, std::ios::trunc);
+    if (!stream.write(content.data(), content.size()))
+        throw std::runtime_error("Can't write " + path);
+}
+
+SceneBenchmark::SceneBenchmark(const std::string& projectPath, const Options& options, std::function<void(bool succeeded)> finished)
+    : m_projectPath(projectPath)
+    , m_options(options)
+    , m_finished(std::move(finished))
+{
+    if (m_options.iterations == 0)
+        throw std::invalid_argument("Benchmark needs at least one iteration");
+    addDependency(EditorManager::id());
+
+    events()->subscribe([this](UpdateEvent) {
+        // Waits for the editor to load the library and its scene
+        if (m_done || manager<EditorManager>()->projectManager() == nullptr)
+            return;
+        m_done = true;
+        bool succeeded = true;
+        try {
+            run();
+        } catch (const std::exception& e) {
+            LOGE("Benchmark failed. %s", e.what());
+            succeeded = false;
+        }
+        m_finished(succeeded);
+    });
+}
+
+void SceneBenchmark::measure(const std::string& name, std::function<void()> setUp, std::function<void()> body) {
+    Result result;
+    result.name = name;
+    for (size_t i = 0; i < m_options.iterations; ++i) {
+        if (setUp)
+            setUp();
+        auto allocationCountBefore = allocationCount.load();
+        auto allocatedBytesBefore = allocatedBytes.load();
+        countingAllocations.store(true);
+        auto start = std::chrono::steady_clock::now();
+        body();
+        result.durations.push_back(std::chrono::steady_clock::now() - start);
+        countingAllocations.store(false);
+        result.allocationCount += allocationCount.load() - allocationCountBefore;
+        result.allocatedBytes += allocatedBytes.load() - allocatedBytesBefore;
+    }
+    result.peakRssKb = peakRssKb();
+    m_results.push_back(std::move(result));
+}
+
+void SceneBenchmark::run() {
+    auto editor = manager<EditorManager>();
+    auto scene = generateScene(m_options.entityCount, m_options.depth);
+    auto sceneText = scene.dump();
+
+    // Same structure, every InternalComponent changed, which is what a reload has to patch
+    auto changedScene = scene;
+    std::function<void(json&)> changeValues = [&changeValues](json& jsonEntity) {
+        auto componentsIter = jsonEntity.find("components");
+        if (componentsIter != jsonEntity.end()) {
+            for (auto& jsonComponent : *componentsIter) {
+                if (jsonComponent.find("value") != jsonComponent.end())
+                    jsonComponent["value"] = jsonComponent["value"].get<int>() + 1;
+            }
+        }
+        auto entitiesIter = jsonEntity.find("entities");
+        if (entitiesIter != jsonEntity.end()) {
+            for (auto& jsonChild : *entitiesIter)
+                changeValues(jsonChild);
+        }
+    };
+    changeValues(changedScene);
+    auto changedSceneText = changedScene.dump();
+
+    auto scenePath = m_projectPath + "/generated/editor/bench.scene";
+    writeFile(scenePath, sceneText);
+
+    LOGI("Benchmark: %zu entities, depth %zu, %zu iterations", m_options.entityCount, m_options.depth, m_options.iterations);
+
+    measure("parse", nullptr, [&sceneText]() {
+        auto jsonTree = json::parse(sceneText);
+    });
+
+    std::shared_ptr<Entity> projectRoot;
+    auto createRoot = [this, &projectRoot, editor]() {
+        projectRoot.reset();
+        projectRoot = editor->createProjectRoot(m_projectPath);
+    };
+    measure("loadFromJson", createRoot, [&projectRoot, &scene]() {
+        projectRoot->manager<ProjectManager>()->loadFromJson(scene);
+    });
+    measure("loadFromJsonParallel", createRoot, [&projectRoot, &scene]() {
+        projectRoot->manager<ProjectManager>()->loadFromJson(scene, &ThreadPool::shared());
+    });
+    measure("loadFromStream", createRoot, [&projectRoot, &sceneText]() {
+        std::istringstream stream(sceneText);
+        projectRoot->manager<ProjectManager>()->loadFromStream(stream);
+    });
+    measure("saveToJson", nullptr, [&projectRoot]() {
+        auto jsonTree = projectRoot->manager<ProjectManager>()->saveToJson();
+    });
+    // Full serialization, then the text of unchanged entities is reused
+    measure("saveToText", [&projectRoot]() {
+        projectRoot->manager<ProjectManager>()->markAllChanged();
+    }, [&projectRoot]() {
+        auto text = projectRoot->manager<ProjectManager>()->saveToText();
+    });
+    measure("saveToTextUnchanged", nullptr, [&projectRoot]() {
+        auto text = projectRoot->manager<ProjectManager>()->saveToText();
+    });
+    measure("indexTypeQuery", nullptr, [&projectRoot]() {
+        auto entities = projectRoot->manager<ProjectManager>()->sceneIndex().entitiesWith("flappy::TextComponent");
+    });
+    projectRoot.reset();
+
+    measure("createScene", [editor, &scene]() {
+        editor->resetProjectRoot();
+        editor->m_serializedTree = scene;
+    }, [this, editor, &scenePath]() {
+        if (!editor->createScene(m_projectPath, scenePath))
+            throw std::runtime_error("createScene failed");
+    });
+
+    if (editor->m_retainSceneTree) {
+        // Every iteration flips the file between the two versions
+        bool changed = false;
+        measure("reloadPatch", [&changed, &scenePath, &sceneText, &changedSceneText]() {
+            changed = !changed;
+            writeFile(scenePath, changed ? changedSceneText : sceneText);
+        }, [editor, &scenePath]() {
+            if (!editor->patchScene(scenePath))
+                throw std::runtime_error("patchScene failed");
+        });
+    }
+
+    // The path taken when the scene can't be patched
+    measure("reloadFull", nullptr, [this, editor, &scenePath]() {
+        editor->resetProjectRoot();
+        if (editor->m_retainSceneTree)
+            editor->m_serializedTree = json::parse(editor->manager<IFileLoadManager>()->loadTextFile(scenePath));
+        if (!editor->createScene(m_projectPath, scenePath))
+            throw std::runtime_error("createScene failed");
+    });
+
+    // Hand the editor back its own scene
+    editor->resetProjectRoot();
+    editor->m_sceneLoaded = false;
+    editor->m_sceneCreated = false;
+    unlink(scenePath.c_str());
+
+    writeResults(componentCount(scene));
+}
+
+void SceneBenchmark::writeResults(size_t componentCount) {
+    auto jsonCases = json::array();
+    for (const auto& result : m_results) {
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+        auto total = std::chrono::nanoseconds::zero();
+        for (auto duration : result.durations)
+            total += duration;
+        auto iterations = result.durations.size();
+        auto meanMs = Milliseconds(total).count() / iterations;
+        auto minMs = Milliseconds(*std::min_element(result.durations.begin(), result.durations.end())).count();
+        auto maxMs = Milliseconds(*std::max_element(result.durations.begin(), result.durations.end())).count();
+        jsonCases.push_back({
+            {"name", result.name},
+            {"meanMs", meanMs},
+            {"minMs", minMs},
+            {"maxMs", maxMs},
+            {"entitiesPerSecond", meanMs > 0 ? m_options.entityCount * 1000.0 / meanMs : 0.0},
+            {"allocationsPerIteration", result.allocationCount / iterations},
+            {"allocatedBytesPerIteration", result.allocatedBytes / iterations},
+            {"peakRssKb", result.peakRssKb}
+        });
+        LOGI("%-22s mean %9.2f ms, min %9.2f ms, %llu allocations", result.name.c_str(), meanMs, minMs,
+             static_cast<unsigned long long>(result.allocationCount / iterations));
+    }
+
+    json jsonResults = {
+        {"timestamp", static_cast<long long>(std::time(nullptr))},
+        {"scene", {
+            {"entities", m_options.entityCount},
+            {"depth", m_options.depth},
+            {"components", componentCount}
+        }},
+        {"iterations", m_options.iterations},
+        {"hardwareConcurrency", std::thread::hardware_concurrency()},
+        {"cases", jsonCases},
+        {"peakRssKb", peakRssKb()}
+    };
+    writeFile(m_options.outputPath, jsonResults.dump(4));
+    LOGI("Benchmark results are written to %s", m_options.outputPath.c_str());
+}
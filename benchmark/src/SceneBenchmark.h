@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <json/json.hpp>
+
+#include <Manager.h>
+
+/// Measures the scene hot paths of the editor on synthetic scenes: json
+/// loading, saving, EditorManager::createScene() and the reload after a scene
+/// file change. Runs once the editor has created its scene, writes the results
+/// as json and calls finished, which quits the application.
+class SceneBenchmark : public flappy::Manager<SceneBenchmark> {
+public:
+    struct Options {
+        std::string outputPath = "bench_results.json";
+        size_t entityCount = 10000;
+        /// At least 1
+        size_t depth = 4;
+        /// At least 1
+        size_t iterations = 5;
+    };
+
+    SceneBenchmark(const std::string& projectPath, const Options& options, std::function<void(bool succeeded)> finished);
+
+    /// Scene of entityCount entities nested depth levels deep, every entity
+    /// has a TransformComponent and some of the test project components
+    static nlohmann::json generateScene(size_t entityCount, size_t depth);
+
+private:
+    struct Result {
+        std::string name;
+        std::vector<std::chrono::nanoseconds> durations;
+        uint64_t allocationCount = 0;
+        uint64_t allocatedBytes = 0;
+        long peakRssKb = 0;
+    };
+
+    std::string m_projectPath;
+    Options m_options;
+    std::function<void(bool succeeded)> m_finished;
+    std::vector<Result> m_results;
+    bool m_done = false;
+
+    void run();
+    /// setUp isn't timed, it prepares every iteration
+    void measure(const std::string& name, std::function<void()> setUp, std::function<void()> body);
+    void writeResults(size_t componentCount);
+};
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <SDL.h>
+
+#include <Entity.h>
+#include <DesktopThread.h>
+#include <PosixApplication.h>
+
+#include "EditorApp.h"
+#include "SceneBenchmark.h"
+
+using namespace flappy;
+
+/// Returns false unless text is a whole number of at least minimum
+static bool parseCount(const char* text, size_t minimum, size_t& count) {
+    try {
+        size_t length = 0;
+        auto value = std::stoul(text, &length);
+        if (text[length] != '\0' || value < minimum || std::string(text).find('-') != std::string::npos)
+            return false;
+        count = value;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 3) {
+        std::cout << "Usage: <project> <results.json> [entities] [depth] [iterations]" << std::endl;
+        return 10;
+    }
+
+    SceneBenchmark::Options options;
+    options.outputPath = argv[2];
+    if ((argc >= 4 && !parseCount(argv[3], 0, options.entityCount))
+            || (argc >= 5 && !parseCount(argv[4], 1, options.depth))
+            || (argc >= 6 && !parseCount(argv[5], 1, options.iterations))) {
+        std::cout << "Entities must be a number, depth and iterations a positive number." << std::endl;
+        return 10;
+    }
+
+    auto succeeded = std::make_shared<bool>(false);
+    PosixApplication application;
+    auto currentThread = std::make_shared<DesktopThread>([argv, options, succeeded](SafePtr<Entity> rootEntity) {
+        auto editor = createEditor(rootEntity, argv[1]);
+        // Measurements aren't delayed by parking
+        editor->idleScheduler().setSimulateContinuously(true);
+        // Quits as if the window was closed, so the editor shuts down its threads and saves
+        editor->entity()->createComponent<SceneBenchmark>(argv[1], options, [succeeded](bool benchmarkSucceeded) {
+            *succeeded = benchmarkSucceeded;
+            SDL_Event event {};
+            event.type = SDL_QUIT;
+            SDL_PushEvent(&event);
+        });
+    });
+    auto status = application.runThread(currentThread);
+    if (status == 0 && !*succeeded)
+        return 1;
+    return status;
+}
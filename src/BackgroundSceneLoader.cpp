@@ -0,0 +1,91 @@
+#include "BackgroundSceneLoader.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Trace.h"
+
+using json = nlohmann::json;
+
+static BackgroundSceneLoader::Result loadScene(BackgroundSceneLoader::Request request,
+                                               const std::atomic<bool>& cancelled) {
+    TRACE_SPAN("BackgroundSceneLoader::load", "scene");
+    BackgroundSceneLoader::Result result;
+    try {
+        if (request.tree.is_null()) {
+            std::ifstream stream(request.scenePath);
+            if (!stream)
+                throw std::runtime_error("Can't open " + request.scenePath);
+            std::stringstream text;
+            text << stream.rdbuf();
+            if (!request.retainTree) {
+                result.text = text.str();
+                return result;
+            }
+            if (cancelled)
+                return result;
+            TRACE_SPAN("BackgroundSceneLoader::parse", "scene");
+            request.tree = json::parse(text.str());
+        }
+        if (cancelled)
+            return result;
+        if (request.retainTree)
+            result.document = SceneDocument::fromJson(request.tree);
+        result.tree = std::move(request.tree);
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    return result;
+}
+
+BackgroundSceneLoader::BackgroundSceneLoader(ThreadPool& threadPool)
+    : m_threadPool(threadPool)
+{}
+
+BackgroundSceneLoader::~BackgroundSceneLoader() {
+    wait();
+}
+
+void BackgroundSceneLoader::start(Request request) {
+    cancel();
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    // The request is moved into the task, std::function needs a copyable callable
+    auto sharedRequest = std::make_shared<Request>(std::move(request));
+    auto future = m_threadPool.submit([sharedRequest, cancelled]() {
+        return loadScene(std::move(*sharedRequest), *cancelled);
+    });
+    m_loads.push_back({cancelled, std::move(future)});
+}
+
+void BackgroundSceneLoader::cancel() {
+    for (auto& load : m_loads)
+        *load.cancelled = true;
+}
+
+void BackgroundSceneLoader::wait() {
+    cancel();
+    for (auto& load : m_loads)
+        load.future.get();
+    m_loads.clear();
+}
+
+bool BackgroundSceneLoader::takeResult(Result& result) {
+    auto isReady = [](const Load& load) {
+        return load.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    for (auto iter = m_loads.begin(); iter != m_loads.end();) {
+        if (iter->cancelled->load() && isReady(*iter)) {
+            iter->future.get();
+            iter = m_loads.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+    if (!busy() || !isReady(m_loads.back()))
+        return false;
+    result = m_loads.back().future.get();
+    m_loads.pop_back();
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <json/json.hpp>
+
+#include "SceneDocument.h"
+#include "ThreadPool.h"
+
+/// Reads and parses a scene and builds its SceneDocument on the thread pool,
+/// the current scene keeps being shown meanwhile. Entities and components
+/// are created from the result on the editor thread, the engine doesn't
+/// promise that creating them on other threads is safe.
+///
+/// Only the latest load is delivered, older ones are cancelled. A cancelled
+/// load stops after reading if it can.
+class BackgroundSceneLoader {
+public:
+    struct Request {
+        std::string scenePath;
+        /// Scene to create, the file is read if it's null
+        nlohmann::json tree;
+        /// Return the parsed tree with the result, without it the file text
+        /// is returned to be streamed
+        bool retainTree = true;
+    };
+
+    struct Result {
+        /// Tree of the request, or the parsed file if the tree is retained
+        nlohmann::json tree;
+        /// Scene file text if the tree is null
+        std::string text;
+        /// Version for the edit history, built when the tree is retained
+        SceneDocument document;
+        /// Empty on success
+        std::string error;
+    };
+
+    explicit BackgroundSceneLoader(ThreadPool& threadPool);
+    BackgroundSceneLoader(const BackgroundSceneLoader&) = delete;
+    BackgroundSceneLoader& operator=(const BackgroundSceneLoader&) = delete;
+    ~BackgroundSceneLoader();
+
+    /// Cancels the running load and starts a new one
+    void start(Request request);
+
+    /// Results of running loads are dropped, doesn't block
+    void cancel();
+
+    /// Cancels and waits until no load runs
+    void wait();
+
+    /// The latest load hasn't been taken yet
+    bool busy() const { return !m_loads.empty() && !m_loads.back().cancelled->load(); }
+
+    /// Finished latest load. Supposed to be polled on the editor thread.
+    bool takeResult(Result& result);
+
+private:
+    struct Load {
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        std::future<Result> future;
+    };
+
+    ThreadPool& m_threadPool;
+    /// Latest load is the last one
+    std::vector<Load> m_loads;
+};
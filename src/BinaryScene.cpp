@@ -0,0 +1,347 @@
+#include "BinaryScene.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace BinaryScene {
+
+static const char magic[4] = {'F', 'S', 'C', 'N'};
+
+class Writer {
+public:
+    std::string finish(std::string body) {
+        std::string result(magic, sizeof(magic));
+        writeInt(result, version, 4);
+        writeInt(result, m_strings.size(), 4);
+        for (const auto& str : m_strings) {
+            writeInt(result, str.size(), 4);
+            result += str;
+        }
+        return result + body;
+    }
+
+    void writeValue(std::string& out, const json& value) {
+        switch (value.type()) {
+        case json::value_t::null:
+        case json::value_t::discarded:
+            writeTag(out, Tag::Null);
+            break;
+        case json::value_t::boolean:
+            writeTag(out, value.get<bool>() ? Tag::True : Tag::False);
+            break;
+        case json::value_t::number_integer:
+            writeTag(out, Tag::Int);
+            writeInt(out, static_cast<uint64_t>(value.get<int64_t>()), 8);
+            break;
+        case json::value_t::number_unsigned:
+            writeTag(out, Tag::UnsignedInt);
+            writeInt(out, value.get<uint64_t>(), 8);
+            break;
+        case json::value_t::number_float: {
+            writeTag(out, Tag::Float);
+            double number = value.get<double>();
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            writeInt(out, bits, 8);
+            break;
+        }
+        case json::value_t::string:
+            writeTag(out, Tag::String);
+            writeString(out, value.get_ref<const std::string&>());
+            break;
+        case json::value_t::array:
+            writeTag(out, Tag::Array);
+            writeInt(out, value.size(), 4);
+            for (const auto& item : value)
+                writeValue(out, item);
+            break;
+        case json::value_t::object:
+            writeTag(out, Tag::Object);
+            writeInt(out, value.size(), 4);
+            for (auto iter = value.begin(); iter != value.end(); iter++) {
+                writeString(out, iter.key());
+                writeValue(out, iter.value());
+            }
+            break;
+        default:
+            throw std::runtime_error("Unsupported json value");
+        }
+    }
+
+    void writeEntity(std::string& out, const json& jsonEntity) {
+        if (!jsonEntity.is_object())
+            throw std::runtime_error("Entity must be an object");
+        auto componentsIter = jsonEntity.find("components");
+        auto entitiesIter = jsonEntity.find("entities");
+        bool hasComponents = componentsIter != jsonEntity.end() && componentsIter->is_array();
+        bool hasEntities = entitiesIter != jsonEntity.end() && entitiesIter->is_array();
+
+        writeInt(out, jsonEntity.size() - (hasComponents ? 1 : 0) - (hasEntities ? 1 : 0), 4);
+        for (auto iter = jsonEntity.begin(); iter != jsonEntity.end(); iter++) {
+            if ((hasComponents && iter == componentsIter) || (hasEntities && iter == entitiesIter))
+                continue;
+            writeString(out, iter.key());
+            writeValue(out, iter.value());
+        }
+        out.push_back(static_cast<char>((hasComponents ? HasComponents : 0) | (hasEntities ? HasEntities : 0)));
+
+        if (hasComponents) {
+            writeInt(out, componentsIter->size(), 4);
+            for (const auto& jsonComponent : *componentsIter)
+                writeComponent(out, jsonComponent);
+        }
+        if (hasEntities) {
+            writeInt(out, entitiesIter->size(), 4);
+            for (const auto& nextJsonEntity : *entitiesIter)
+                writeEntity(out, nextJsonEntity);
+        }
+    }
+
+private:
+    std::vector<std::string> m_strings;
+    std::unordered_map<std::string, uint32_t> m_stringIndices;
+
+    static void writeInt(std::string& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++)
+            out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+
+    static void writeTag(std::string& out, Tag tag) {
+        out.push_back(static_cast<char>(tag));
+    }
+
+    void writeString(std::string& out, const std::string& str) {
+        auto iter = m_stringIndices.find(str);
+        if (iter == m_stringIndices.end()) {
+            iter = m_stringIndices.emplace(str, static_cast<uint32_t>(m_strings.size())).first;
+            m_strings.push_back(str);
+        }
+        writeInt(out, iter->second, 4);
+    }
+
+    void writeComponent(std::string& out, const json& jsonComponent) {
+        if (!jsonComponent.is_object())
+            throw std::runtime_error("Component must be an object");
+        auto typeIter = jsonComponent.find("type");
+        bool hasType = typeIter != jsonComponent.end() && typeIter->is_string();
+        if (hasType)
+            writeString(out, typeIter->get_ref<const std::string&>());
+        else
+            writeInt(out, noString, 4);
+        writeInt(out, jsonComponent.size() - (hasType ? 1 : 0), 4);
+        for (auto iter = jsonComponent.begin(); iter != jsonComponent.end(); iter++) {
+            if (hasType && iter == typeIter)
+                continue;
+            writeString(out, iter.key());
+            writeValue(out, iter.value());
+        }
+    }
+};
+
+std::string fromJson(const json& jsonTree) {
+    Writer writer;
+    std::string body;
+    writer.writeEntity(body, jsonTree);
+    return writer.finish(std::move(body));
+}
+
+Reader::Reader(const char* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+{
+    char fileMagic[sizeof(magic)];
+    read(fileMagic, sizeof(fileMagic));
+    if (std::memcmp(fileMagic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error("Not a binary scene");
+    auto fileVersion = readCount();
+    if (fileVersion != version)
+        throw std::runtime_error("Unsupported binary scene version " + std::to_string(fileVersion));
+    auto stringCount = readCount(4);
+    m_strings.reserve(stringCount);
+    for (uint32_t i = 0; i < stringCount; i++) {
+        auto length = readCount();
+        if (length > m_size - m_pos)
+            throw std::runtime_error("Unexpected end of binary scene");
+        m_strings.emplace_back(m_data + m_pos, length);
+        m_pos += length;
+    }
+}
+
+const std::string& Reader::string(uint32_t index) const {
+    if (index >= m_strings.size())
+        throw std::runtime_error("Invalid string index");
+    return m_strings[index];
+}
+
+void Reader::read(void* target, size_t size) {
+    if (size > m_size - m_pos)
+        throw std::runtime_error("Unexpected end of binary scene");
+    std::memcpy(target, m_data + m_pos, size);
+    m_pos += size;
+}
+
+uint8_t Reader::readByte() {
+    uint8_t value;
+    read(&value, 1);
+    return value;
+}
+
+uint32_t Reader::readCount() {
+    unsigned char bytes[4];
+    read(bytes, sizeof(bytes));
+    return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+uint32_t Reader::readCount(size_t itemSize) {
+    auto count = readCount();
+    if (count > (m_size - m_pos) / itemSize)
+        throw std::runtime_error("Unexpected end of binary scene");
+    return count;
+}
+
+Reader::Nesting::Nesting(Reader& reader)
+    : m_reader(reader)
+{
+    if (m_reader.m_depth == maxDepth)
+        throw std::runtime_error("Binary scene is nested too deep");
+    m_reader.m_depth++;
+}
+
+uint32_t Reader::readStringIndex() {
+    auto index = readCount();
+    if (index != noString && index >= m_strings.size())
+        throw std::runtime_error("Invalid string index");
+    return index;
+}
+
+json Reader::readValue() {
+    auto readInt64 = [this]() {
+        unsigned char bytes[8];
+        read(bytes, sizeof(bytes));
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; i--)
+            value = value << 8 | bytes[i];
+        return value;
+    };
+
+    switch (static_cast<Tag>(readByte())) {
+    case Tag::Null:
+        return nullptr;
+    case Tag::False:
+        return false;
+    case Tag::True:
+        return true;
+    case Tag::Int:
+        return static_cast<int64_t>(readInt64());
+    case Tag::UnsignedInt:
+        return readInt64();
+    case Tag::Float: {
+        auto bits = readInt64();
+        double number;
+        std::memcpy(&number, &bits, sizeof(number));
+        return number;
+    }
+    case Tag::String:
+        return string(readCount());
+    case Tag::Array: {
+        Nesting nesting(*this);
+        json result = json::array();
+        // A value takes at least its tag
+        auto count = readCount(1);
+        for (uint32_t i = 0; i < count; i++)
+            result.push_back(readValue());
+        return result;
+    }
+    case Tag::Object: {
+        Nesting nesting(*this);
+        json result = json::object();
+        auto count = readCount(5);
+        for (uint32_t i = 0; i < count; i++) {
+            const auto& key = string(readCount());
+            result[key] = readValue();
+        }
+        return result;
+    }
+    }
+    throw std::runtime_error("Invalid value tag");
+}
+
+static json readEntity(Reader& reader) {
+    Reader::Nesting nesting(reader);
+    json jsonEntity = json::object();
+    auto fieldCount = reader.readCount(5);
+    for (uint32_t i = 0; i < fieldCount; i++) {
+        const auto& key = reader.string(reader.readCount());
+        jsonEntity[key] = reader.readValue();
+    }
+    auto flags = reader.readByte();
+    if (flags & HasComponents) {
+        json jsonComponents = json::array();
+        auto componentCount = reader.readCount(8);
+        for (uint32_t i = 0; i < componentCount; i++) {
+            json jsonComponent = json::object();
+            auto typeIndex = reader.readStringIndex();
+            if (typeIndex != noString)
+                jsonComponent["type"] = reader.string(typeIndex);
+            auto componentFieldCount = reader.readCount(5);
+            for (uint32_t j = 0; j < componentFieldCount; j++) {
+                const auto& key = reader.string(reader.readCount());
+                jsonComponent[key] = reader.readValue();
+            }
+            jsonComponents.push_back(std::move(jsonComponent));
+        }
+        jsonEntity["components"] = std::move(jsonComponents);
+    }
+    if (flags & HasEntities) {
+        json jsonEntities = json::array();
+        auto entityCount = reader.readCount(5);
+        for (uint32_t i = 0; i < entityCount; i++)
+            jsonEntities.push_back(readEntity(reader));
+        jsonEntity["entities"] = std::move(jsonEntities);
+    }
+    return jsonEntity;
+}
+
+json toJson(const char* data, size_t size) {
+    Reader reader(data, size);
+    auto jsonTree = readEntity(reader);
+    if (!reader.atEnd())
+        throw std::runtime_error("Trailing data in binary scene");
+    return jsonTree;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Can't open " + path);
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error("Can't stat " + path);
+    }
+    m_size = static_cast<size_t>(fileStat.st_size);
+    if (m_size > 0) {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Can't map " + path);
+        }
+        m_data = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr)
+        munmap(const_cast<char*>(m_data), m_size);
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <json/json.hpp>
+
+/// Binary scene format, version 1. All numbers are little-endian and unaligned.
+///
+///     header:    "FSCN" u32:version u32:stringCount (u32:length bytes)*
+///     entity:    u32:fieldCount (u32:key value)* u8:flags
+///                [u32:componentCount component*] [u32:entityCount entity*]
+///     component: u32:type u32:fieldCount (u32:key value)*
+///     value:     u8:tag payload
+///
+/// Keys, type names and string values are indices in the string table.
+/// Entity fields are all keys except "components" and "entities" arrays,
+/// flags tell which of the arrays are present.
+namespace BinaryScene {
+
+constexpr uint32_t version = 1;
+constexpr uint32_t noString = 0xFFFFFFFF;
+/// Deepest nesting of entities and values a reader accepts
+constexpr size_t maxDepth = 512;
+
+enum EntityFlags : uint8_t {
+    HasComponents = 1,
+    HasEntities = 2
+};
+
+enum class Tag : uint8_t {
+    Null,
+    False,
+    True,
+    Int,
+    UnsignedInt,
+    Float,
+    String,
+    Array,
+    Object
+};
+
+/// Throws std::runtime_error if the tree can't be represented losslessly
+std::string fromJson(const nlohmann::json& jsonTree);
+
+nlohmann::json toJson(const char* data, size_t size);
+
+class Reader {
+public:
+    /// Reads the header and the string table. Data must outlive the reader.
+    Reader(const char* data, size_t size);
+
+    /// Scope of a nested entity or value, throws past maxDepth
+    class Nesting {
+    public:
+        explicit Nesting(Reader& reader);
+        Nesting(const Nesting&) = delete;
+        Nesting& operator=(const Nesting&) = delete;
+        ~Nesting() { m_reader.m_depth--; }
+
+    private:
+        Reader& m_reader;
+    };
+
+    const std::string& string(uint32_t index) const;
+
+    uint8_t readByte();
+    uint32_t readCount();
+    /// Count of items taking at least itemSize bytes each, throws if they
+    /// can't fit in the rest of the data
+    uint32_t readCount(size_t itemSize);
+    /// Returns noString for a missing component type
+    uint32_t readStringIndex();
+    nlohmann::json readValue();
+    bool atEnd() const { return m_pos == m_size; }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    size_t m_depth = 0;
+    std::vector<std::string> m_strings;
+
+    void read(void* target, size_t size);
+};
+
+/// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+}
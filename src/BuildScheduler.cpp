@@ -0,0 +1,124 @@
+#include "BuildScheduler.h"
+
+#include <iostream>
+
+#include <process.hpp>
+
+#include "Trace.h"
+
+using namespace TinyProcessLib;
+
+BuildScheduler::BuildScheduler(const std::string& projectPath, std::function<std::string(JobKind)> makeCommand)
+    : m_projectPath(projectPath)
+    , m_makeCommand(std::move(makeCommand))
+    , m_thread([this]() { schedulerLoop(); })
+{}
+
+BuildScheduler::~BuildScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+const char* BuildScheduler::scriptName(JobKind kind) {
+    switch (kind) {
+    case JobKind::Build: return "build";
+    case JobKind::PackRes: return "pack_res";
+    }
+    return "";
+}
+
+void BuildScheduler::setDebounce(Clock::duration debounce) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_debounce = debounce;
+}
+
+void BuildScheduler::setFinishedCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finishedCallback = std::move(callback);
+}
+
+void BuildScheduler::request(JobKind kind) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending[static_cast<size_t>(kind)] = true;
+        m_lastRequestTime = Clock::now();
+        // Output of the running job is already stale
+        if (m_running && m_runningKind == kind)
+            m_restartRunning = true;
+    }
+    m_condition.notify_all();
+}
+
+std::vector<BuildScheduler::Result> BuildScheduler::takeResults() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Result> results;
+    results.swap(m_results);
+    return results;
+}
+
+void BuildScheduler::schedulerLoop() {
+    Tracer::instance().setThreadName("BuildScheduler");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this]() {
+            return m_stopped || m_pending[0] || m_pending[1];
+        });
+        if (m_stopped)
+            return;
+
+        // Wait until the burst of requests is over
+        auto deadline = m_lastRequestTime + m_debounce;
+        if (Clock::now() < deadline) {
+            m_condition.wait_until(lock, deadline);
+            continue;
+        }
+
+        // One job at a time, so build and pack_res never touch the tree concurrently
+        auto kind = m_pending[static_cast<size_t>(JobKind::Build)] ? JobKind::Build : JobKind::PackRes;
+        m_pending[static_cast<size_t>(kind)] = false;
+        m_running = true;
+        m_runningKind = kind;
+        m_restartRunning = false;
+
+        lock.unlock();
+        auto result = runJob(kind);
+        lock.lock();
+
+        m_running = false;
+        m_results.push_back(result);
+        if (m_finishedCallback) {
+            auto callback = m_finishedCallback;
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+    }
+}
+
+BuildScheduler::Result BuildScheduler::runJob(JobKind kind) {
+    TRACE_SPAN(kind == JobKind::Build ? "flappy build" : "flappy pack_res", "build");
+    auto startTime = Clock::now();
+    auto printOutput = [](const char *bytes, size_t n) {
+        std::cout << std::string(bytes, n);
+    };
+    Process process(m_makeCommand(kind), m_projectPath, printOutput, printOutput);
+
+    Result result {kind, 0, false, {}};
+    while (!process.try_get_exit_status(result.exitStatus)) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_restartRunning || m_stopped) {
+            lock.unlock();
+            process.kill();
+            result.exitStatus = process.get_exit_status();
+            result.cancelled = true;
+            break;
+        }
+        m_condition.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    result.duration = Clock::now() - startTime;
+    return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Runs flappy scripts for the project one at a time on a worker thread.
+/// Requests are debounced and coalesced into a single pending job per kind,
+/// a request for the job which is running at the moment restarts it.
+class BuildScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class JobKind {
+        Build,
+        PackRes
+    };
+
+    struct Result {
+        JobKind kind;
+        int exitStatus;
+        bool cancelled;
+        Clock::duration duration;
+    };
+
+    /// makeCommand returns a shell command for a job kind
+    BuildScheduler(const std::string& projectPath, std::function<std::string(JobKind)> makeCommand);
+    BuildScheduler(const BuildScheduler&) = delete;
+    BuildScheduler& operator=(const BuildScheduler&) = delete;
+    ~BuildScheduler();
+
+    static const char* scriptName(JobKind kind);
+
+    void setDebounce(Clock::duration debounce);
+
+    /// Called on the worker thread when a job finishes, takeResults() has it then
+    void setFinishedCallback(std::function<void()> callback);
+
+    /// Thread safe
+    void request(JobKind kind);
+
+    /// Finished jobs since the last call. Supposed to be polled on the editor thread.
+    std::vector<Result> takeResults();
+
+private:
+    static constexpr size_t jobKindCount = 2;
+
+    std::string m_projectPath;
+    std::function<std::string(JobKind)> m_makeCommand;
+    Clock::duration m_debounce = std::chrono::milliseconds(300);
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_pending[jobKindCount] = {};
+    Clock::time_point m_lastRequestTime;
+    bool m_running = false;
+    JobKind m_runningKind = JobKind::Build;
+    bool m_restartRunning = false;
+    bool m_stopped = false;
+    std::vector<Result> m_results;
+    std::function<void()> m_finishedCallback;
+    std::thread m_thread;
+
+    void schedulerLoop();
+    Result runJob(JobKind kind);
+};
@@ -0,0 +1,226 @@
+#include "EditHistory.h"
+
+#include <algorithm>
+
+#include "ProjectManager.h"
+
+using json = nlohmann::json;
+
+/// Brings the live subtree at path from one document version to another.
+/// Subtrees and components shared by both versions are skipped.
+static void patchNode(ProjectManager& project,
+                      ScenePath& path,
+                      const SceneDocument& target,
+                      const SceneDocument::Node& fromNode,
+                      const SceneDocument::Node& toNode) {
+    auto commonComponents = std::min(fromNode.components.size(), toNode.components.size());
+    for (size_t i = 0; i < commonComponents; i++) {
+        const auto& fromComponent = fromNode.components[i];
+        const auto& toComponent = toNode.components[i];
+        if (fromComponent == toComponent || *fromComponent == *toComponent)
+            continue;
+        bool sameType = fromComponent->value("type", std::string()) == toComponent->value("type", std::string());
+        // A field can't be unset, the component is recreated to get the default back
+        bool fieldRemoved = false;
+        for (auto fieldIter = fromComponent->begin(); fieldIter != fromComponent->end() && sameType; fieldIter++)
+            fieldRemoved |= toComponent->find(fieldIter.key()) == toComponent->end();
+        if (!sameType || fieldRemoved) {
+            project.eraseComponent(path, i);
+            project.insertComponent(path, i, *toComponent);
+            continue;
+        }
+        for (auto fieldIter = toComponent->begin(); fieldIter != toComponent->end(); fieldIter++) {
+            auto fromFieldIter = fromComponent->find(fieldIter.key());
+            if (fieldIter.key() != "type" && (fromFieldIter == fromComponent->end() || *fromFieldIter != fieldIter.value()))
+                project.setPropertyValue(path, i, fieldIter.key(), fieldIter.value());
+        }
+    }
+    for (size_t i = fromNode.components.size(); i > commonComponents; i--)
+        project.eraseComponent(path, i - 1);
+    for (size_t i = commonComponents; i < toNode.components.size(); i++)
+        project.insertComponent(path, i, *toNode.components[i]);
+
+    auto commonChildren = std::min(fromNode.children.size(), toNode.children.size());
+    for (size_t i = 0; i < commonChildren; i++) {
+        if (fromNode.children[i] == toNode.children[i])
+            continue;
+        path.push_back(i);
+        patchNode(project, path, target, *fromNode.children[i], *toNode.children[i]);
+        path.pop_back();
+    }
+    for (size_t i = fromNode.children.size(); i > commonChildren; i--)
+        project.eraseEntity(path, i - 1);
+    for (size_t i = commonChildren; i < toNode.children.size(); i++) {
+        path.push_back(i);
+        auto jsonEntity = target.toJson(path);
+        path.pop_back();
+        project.insertEntity(path, i, jsonEntity);
+    }
+}
+
+/// Brings the live subtree at path back to the document after an edit of
+/// the live tree failed halfway
+static void restoreNode(ProjectManager& project, const ScenePath& path, const SceneDocument& document) {
+    try {
+        auto live = SceneDocument::fromJson(project.entityToJson(path));
+        auto patchPath = path;
+        patchNode(project, patchPath, document, *live.root(), document.node(path));
+    } catch (const std::exception& e) {
+        LOGE("Can't restore the scene after a failed edit. %s", e.what());
+    }
+}
+
+EditHistory::EditHistory(size_t maxCommands, size_t checkpointInterval)
+    : m_maxCommands(std::max<size_t>(maxCommands, 1))
+    , m_checkpointInterval(std::max<size_t>(checkpointInterval, 1))
+{
+    m_checkpoints.emplace_back(0, m_document);
+}
+
+void EditHistory::reset(const SceneDocument& document) {
+    m_commands.clear();
+    m_position = 0;
+    m_document = document;
+    m_checkpoints.clear();
+    m_checkpoints.emplace_back(0, m_document);
+}
+
+void EditHistory::setProperty(ProjectManager& project, const ScenePath& path, size_t componentIndex, const std::string& name, const json& value) {
+    auto before = project.propertyValue(path, componentIndex, name);
+    record(project, {Command::Kind::SetProperty, path, componentIndex, name, std::move(before), value});
+}
+
+void EditHistory::addComponent(ProjectManager& project, const ScenePath& path, size_t index, const json& jsonComponent) {
+    record(project, {Command::Kind::AddComponent, path, index, {}, nullptr, jsonComponent});
+}
+
+void EditHistory::removeComponent(ProjectManager& project, const ScenePath& path, size_t index) {
+    auto before = project.componentToJson(path, index);
+    record(project, {Command::Kind::RemoveComponent, path, index, {}, std::move(before), nullptr});
+}
+
+void EditHistory::addEntity(ProjectManager& project, const ScenePath& parentPath, size_t index, const json& jsonEntity) {
+    record(project, {Command::Kind::AddEntity, parentPath, index, {}, nullptr, jsonEntity});
+}
+
+void EditHistory::removeEntity(ProjectManager& project, const ScenePath& parentPath, size_t index) {
+    auto path = parentPath;
+    path.push_back(index);
+    auto before = project.entityToJson(path);
+    record(project, {Command::Kind::RemoveEntity, parentPath, index, {}, std::move(before), nullptr});
+}
+
+void EditHistory::record(ProjectManager& project, Command command) {
+    apply(project, command, true);
+
+    m_commands.erase(m_commands.begin() + m_position, m_commands.end());
+    while (!m_checkpoints.empty() && m_checkpoints.back().first > m_position)
+        m_checkpoints.pop_back();
+
+    m_commands.push_back(std::move(command));
+    m_position++;
+    if (m_checkpoints.empty() || m_position - m_checkpoints.back().first >= m_checkpointInterval)
+        m_checkpoints.emplace_back(m_position, m_document);
+
+    if (m_commands.size() > m_maxCommands) {
+        // The state before the oldest command is gone, and its checkpoint with it
+        if (!m_checkpoints.empty() && m_checkpoints.front().first == 0)
+            m_checkpoints.pop_front();
+        for (auto& checkpoint : m_checkpoints)
+            checkpoint.first--;
+        m_commands.pop_front();
+        m_position--;
+    }
+}
+
+void EditHistory::apply(ProjectManager& project, const Command& command, bool forward) {
+    using Kind = Command::Kind;
+    bool adding = (command.kind == Kind::AddComponent || command.kind == Kind::AddEntity) == forward;
+    const auto& value = forward ? command.after : command.before;
+
+    // A wrong path throws here, before anything is changed
+    SceneDocument document;
+    switch (command.kind) {
+    case Kind::SetProperty:
+        document = m_document.withProperty(command.path, command.index, command.name, value);
+        break;
+    case Kind::AddComponent:
+    case Kind::RemoveComponent:
+        document = adding ? m_document.withComponent(command.path, command.index, value)
+                          : m_document.withoutComponent(command.path, command.index);
+        break;
+    case Kind::AddEntity:
+    case Kind::RemoveEntity:
+        document = adding ? m_document.withEntity(command.path, command.index, value)
+                          : m_document.withoutEntity(command.path, command.index);
+        break;
+    }
+
+    try {
+        switch (command.kind) {
+        case Kind::SetProperty:
+            project.setPropertyValue(command.path, command.index, command.name, value);
+            break;
+        case Kind::AddComponent:
+        case Kind::RemoveComponent:
+            if (adding)
+                project.insertComponent(command.path, command.index, value);
+            else
+                project.eraseComponent(command.path, command.index);
+            break;
+        case Kind::AddEntity:
+        case Kind::RemoveEntity:
+            if (adding)
+                project.insertEntity(command.path, command.index, value);
+            else
+                project.eraseEntity(command.path, command.index);
+            break;
+        }
+    } catch (...) {
+        // The document keeps the previous version, the live tree follows it
+        restoreNode(project, command.path, m_document);
+        throw;
+    }
+    m_document = std::move(document);
+}
+
+void EditHistory::moveTo(ProjectManager& project, size_t position) {
+    auto distance = [](size_t a, size_t b) { return a > b ? a - b : b - a; };
+
+    // A single step is cheaper as a command, a longer way may start at a checkpoint
+    auto bestIter = m_checkpoints.end();
+    for (auto iter = m_checkpoints.begin(); iter != m_checkpoints.end(); iter++) {
+        if (bestIter == m_checkpoints.end() || distance(iter->first, position) < distance(bestIter->first, position))
+            bestIter = iter;
+    }
+    if (bestIter != m_checkpoints.end() && distance(bestIter->first, position) + 1 < distance(m_position, position)) {
+        ScenePath path;
+        try {
+            patchNode(project, path, bestIter->second, *m_document.root(), *bestIter->second.root());
+        } catch (...) {
+            restoreNode(project, ScenePath(), m_document);
+            throw;
+        }
+        m_document = bestIter->second;
+        m_position = bestIter->first;
+    }
+
+    for (; m_position < position; m_position++)
+        apply(project, m_commands[m_position], true);
+    for (; m_position > position; m_position--)
+        apply(project, m_commands[m_position - 1], false);
+}
+
+bool EditHistory::undo(ProjectManager& project, size_t steps) {
+    if (steps > undoCount())
+        return false;
+    moveTo(project, m_position - steps);
+    return true;
+}
+
+bool EditHistory::redo(ProjectManager& project, size_t steps) {
+    if (steps > redoCount())
+        return false;
+    moveTo(project, m_position + steps);
+    return true;
+}
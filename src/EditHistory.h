@@ -0,0 +1,81 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <utility>
+
+#include <json/json.hpp>
+
+#include "SceneDocument.h"
+#include "SceneNode.h"
+
+class ProjectManager;
+
+/// Undo/redo of scene edits. Every edit is recorded as a small command that
+/// holds only the values it replaced, undo applies the inverse command to the
+/// live tree.
+///
+/// Every checkpointInterval commands the current SceneDocument version is
+/// kept. Versions share unchanged subtrees, so a checkpoint only costs the
+/// nodes edited since the previous one. A long jump through the history
+/// patches the live tree from the nearest checkpoint, which compares versions
+/// by skipping shared subtrees, instead of replaying every command.
+class EditHistory {
+public:
+    explicit EditHistory(size_t maxCommands = 1000, size_t checkpointInterval = 64);
+
+    /// Forgets the history, document describes the loaded scene
+    void reset(const SceneDocument& document);
+
+    /// Edits are applied to the project and recorded, a failed edit throws
+    /// and isn't recorded, the live tree is brought back to document().
+    /// A new edit drops the commands that could be redone.
+    void setProperty(ProjectManager& project, const ScenePath& path, size_t componentIndex, const std::string& name, const nlohmann::json& value);
+    void addComponent(ProjectManager& project, const ScenePath& path, size_t index, const nlohmann::json& jsonComponent);
+    void removeComponent(ProjectManager& project, const ScenePath& path, size_t index);
+    void addEntity(ProjectManager& project, const ScenePath& parentPath, size_t index, const nlohmann::json& jsonEntity);
+    void removeEntity(ProjectManager& project, const ScenePath& parentPath, size_t index);
+
+    size_t undoCount() const { return m_position; }
+    size_t redoCount() const { return m_commands.size() - m_position; }
+
+    /// Return false if there are fewer steps to go
+    bool undo(ProjectManager& project, size_t steps = 1);
+    bool redo(ProjectManager& project, size_t steps = 1);
+
+    /// Scene matching the live tree
+    const SceneDocument& document() const { return m_document; }
+
+private:
+    struct Command {
+        enum class Kind {
+            SetProperty,
+            AddComponent,
+            RemoveComponent,
+            AddEntity,
+            RemoveEntity
+        };
+
+        Kind kind;
+        /// Entity of the property or component, parent of an added or removed entity
+        ScenePath path;
+        /// Component or child entity index
+        size_t index;
+        std::string name;
+        nlohmann::json before;
+        nlohmann::json after;
+    };
+
+    size_t m_maxCommands;
+    size_t m_checkpointInterval;
+    std::deque<Command> m_commands;
+    /// Number of applied commands, the rest can be redone
+    size_t m_position = 0;
+    /// Document versions by the number of commands applied, in order
+    std::deque<std::pair<size_t, SceneDocument>> m_checkpoints;
+    SceneDocument m_document;
+
+    void record(ProjectManager& project, Command command);
+    void apply(ProjectManager& project, const Command& command, bool forward);
+    void moveTo(ProjectManager& project, size_t position);
+};
@@ -0,0 +1,63 @@
+#include "EditorApp.h"
+
+#include <chrono>
+#include <cstdlib>
+
+#include <SDL.h>
+
+#include <TransformComponent.h>
+#include <ResManager.h>
+#include <StdFileMonitorManager.h>
+#include <ResRepositoryManager.h>
+#include <StdFileLoadManager.h>
+#include <TextResFactory.h>
+#include <SceneManager.h>
+#include <Sdl2Manager.h>
+#include <GLRenderManager.h>
+#include <GLRenderElementFactory.h>
+#include <ScreenManager.h>
+
+#include "IdleScheduler.h"
+
+using namespace flappy;
+
+SafePtr<EditorManager> createEditor(SafePtr<Entity> rootEntity, const std::string& projectPath) {
+    rootEntity->createComponent<Sdl2Manager>();
+    rootEntity->createComponent<ScreenManager>(600, 600);
+
+    rootEntity->createComponent<ResRepositoryManager>("./resources");
+    rootEntity->createComponent<StdFileMonitorManager>();
+    rootEntity->createComponent<StdFileLoadManager>();
+    rootEntity->createComponent<TextResFactory>();
+    rootEntity->createComponent<ResManager<TextRes>> ();
+
+    // Scene
+    auto sceneEntity = rootEntity->createEntity();
+    sceneEntity->component<SceneManager>()->setMainCamera(sceneEntity->component<CameraComponent>());
+    sceneEntity->component<CameraComponent>()->setSize({600, 600});
+    sceneEntity->component<GLRenderManager>();
+    sceneEntity->component<GLRenderElementFactory>();
+
+    // Editor initialization
+    auto editor = sceneEntity->createComponent<EditorManager>(projectPath);
+    editor->selectScene("./res_src/TestScene.scene");
+    if (auto tracePath = std::getenv("FLAPPY_EDITOR_TRACE"))
+        editor->setTracePath(tracePath);
+
+    // The parked loop blocks until a window or input event arrives, other
+    // threads wake it with an event of its own. SDL 2.0.16 and newer wait
+    // in the window system instead of polling.
+    auto wakeEventType = SDL_RegisterEvents(1);
+    editor->idleScheduler().setWaiter([](IdleScheduler::Clock::duration timeout) {
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count();
+        return SDL_WaitEventTimeout(nullptr, static_cast<int>(milliseconds)) == 1;
+    }, [wakeEventType]() {
+        SDL_Event event {};
+        event.type = wakeEventType;
+        SDL_PushEvent(&event);
+    });
+    // For scenes animated by their own components
+    if (std::getenv("FLAPPY_EDITOR_CONTINUOUS"))
+        editor->idleScheduler().setSimulateContinuously(true);
+    return editor;
+}
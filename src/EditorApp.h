@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+#include <Entity.h>
+
+#include "EditorManager.h"
+
+/// Window, resource and scene setup of the editor shared by the editor and
+/// benchmark executables. Selects the test scene of the project.
+flappy::SafePtr<EditorManager> createEditor(flappy::SafePtr<flappy::Entity> rootEntity, const std::string& projectPath);
@@ -1,18 +1,28 @@
 #include "EditorManager.h"
 
-#include <atomic>
+#include <fstream>
+#include <sstream>
 #include <Entity.h>
 #include <IFileMonitorManager.h>
 #include <IFileLoadManager.h>
 #include <process.hpp>
 
+#include "./BackgroundSceneLoader.h"
+#include "./BuildScheduler.h"
+#include "./FileWatcher.h"
+#include "./IdleScheduler.h"
+#include "./Prefab.h"
 #include "./ProjectManager.h"
+#include "./ResourceCache.h"
+#include "./SceneCache.h"
+#include "./SceneSaver.h"
+#include "./Property.h"
+#include "./ThreadPool.h"
+#include "./Trace.h"
 
 using namespace flappy;
 using namespace TinyProcessLib;
 
-std::atomic<bool> flappyBuildStarted;
-
 // TODO: Find crossplatform solution
 static std::string bashify(const std::string command) {
     std::stringstream ss;
@@ -20,21 +30,6 @@ static std::string bashify(const std::string command) {
     return ss.str();
 }
 
-static void runFlappyBuild(const std::string& projectPath, const std::string& scriptName) {
-    std::thread flappyBuildThread ([projectPath, scriptName]() {
-        flappyBuildStarted = true;
-        Process process(bashify("flappy " + scriptName + " cmake +editor"), projectPath, [](const char *bytes, size_t n) {
-                std::cout << std::string(bytes, n);
-            }, [](const char *bytes, size_t n) {
-                std::cout << std::string(bytes, n);
-            });
-        flappyBuildStarted = false;
-        auto exit_status=process.get_exit_status();
-        std::cout << "flappy build returned: " << exit_status << " (" << (exit_status==0?"success":"failure") << ")" << std::endl;
-    });
-    flappyBuildThread.detach();
-}
-
 // TODO: Implement process as a class with possibility to kill it and set callbacks
 static void runProcess(const std::string& projectPath, const std::string& execPath, std::function<void(const char *bytes, size_t n)> callback) {
     std::thread fsWatchThread ([projectPath, execPath, callback]() {
@@ -49,13 +44,33 @@ static void runProcess(const std::string& projectPath, const std::string& execPa
 }
 
 EditorManager::EditorManager(const std::string& projectPath)
+    : m_buildScheduler(std::make_shared<BuildScheduler>(projectPath, [](BuildScheduler::JobKind kind) {
+        return bashify(std::string("flappy ") + BuildScheduler::scriptName(kind) + " cmake +editor");
+    }))
+    , m_idleScheduler(std::make_shared<IdleScheduler>())
+    , m_sceneLoader(std::make_unique<BackgroundSceneLoader>(ThreadPool::shared()))
+    , m_sceneSaver(std::make_unique<SceneSaver>())
+    , m_sceneCache(std::make_unique<SceneCache>())
+    , m_projectPath(projectPath)
 {
     addDependency(IFileMonitorManager::id());
 
+    // Prefab references in scenes are relative to the project
+    PrefabRegistry::instance().setBasePath(projectPath);
+
     // FIXME: Search actual location of library
     auto libraryPath = projectPath + "/generated/cmake/build/libTestProject.dylib";
 
+    auto idleScheduler = m_idleScheduler;
+    m_buildScheduler->setFinishedCallback([idleScheduler]() { idleScheduler->wake(); });
+
     events()->subscribe([this, libraryPath, projectPath](InitEvent) {
+        m_resourceCache = std::make_unique<ResourceCache>(projectPath + "/generated/cmake/resources",
+                                                          projectPath + "/generated/editor/resources");
+        m_resourceCache->sync();
+        for (auto managerPair : managers())
+            m_resourceCache->entity()->events()->post(ManagerAddedEvent(managerPair.second));
+
         m_projectRoot = std::make_shared<Entity>();
 
         for (auto managerPair : managers()) {
@@ -63,52 +78,198 @@ EditorManager::EditorManager(const std::string& projectPath)
             m_projectRoot->events()->post(ManagerAddedEvent(managerPair.second));
         }
 
-        runFlappyBuild(projectPath, "build");
+        m_buildScheduler->request(BuildScheduler::JobKind::Build);
 
-        runProcess(projectPath, "fswatch ./src ./flappy_conf", [projectPath](const char *bytes, size_t n) {
-            if (!flappyBuildStarted)
-                runFlappyBuild(projectPath, "build");
+        if (startFileWatcher(projectPath, libraryPath))
+            return;
+
+        // Watch threads outlive the manager, so they share the schedulers
+        auto buildScheduler = m_buildScheduler;
+        auto idleScheduler = m_idleScheduler;
+        runProcess(projectPath, "fswatch ./src ./flappy_conf", [buildScheduler, idleScheduler](const char *bytes, size_t n) {
+            buildScheduler->request(BuildScheduler::JobKind::Build);
+            idleScheduler->wake();
             std::cout << std::string(bytes, n);
         });
-        runProcess(projectPath, "fswatch ./res_src", [projectPath](const char *bytes, size_t n) {
-            if (!flappyBuildStarted)
-                runFlappyBuild(projectPath, "pack_res");
+        runProcess(projectPath, "fswatch ./res_src", [buildScheduler, idleScheduler](const char *bytes, size_t n) {
+            buildScheduler->request(BuildScheduler::JobKind::PackRes);
+            idleScheduler->wake();
             std::cout << std::string(bytes, n);
         });
     });
 
     events()->subscribeAll([this] (const EventHandle& eventHandle) {
-        if (!isInitialized())
+        // Updates are forwarded by the update handler, with the parked time left out
+        if (!isInitialized() || eventHandle.id() == GetTypeId<EventHandle, UpdateEvent>::value())
             return;
-        if (eventHandle.id() != GetTypeId<EventHandle, InitEvent>::value())
+        if (m_resourceCache && m_resourceCache->eventRoutes().forwards(eventHandle.id()))
+            m_resourceCache->entity()->events()->post(eventHandle);
+        if (m_projectRoot && m_projectRoutes && m_projectRoutes->forwards(eventHandle.id()))
             m_projectRoot->events()->post(eventHandle);
     });
 
-    events()->subscribe([this, projectPath, libraryPath](UpdateEvent) {
-        auto fileMonitor = manager<IFileMonitorManager>();
-        if (fileMonitor->exists(libraryPath) && fileMonitor->changed(libraryPath)) {
-            m_libraryLoaded = false;
+    events()->subscribe([this, projectPath, libraryPath](UpdateEvent updateEvent) {
+        // A frame after a park would step live components by the whole parked time
+        auto dt = m_parked ? m_lastFrameTime : updateEvent.dt;
+        m_lastFrameTime = dt;
+        if (m_resourceCache)
+            m_resourceCache->entity()->events()->post(UpdateEvent(dt));
+        if (m_projectRoot)
+            m_projectRoot->events()->post(UpdateEvent(dt));
+
+        // Work in flight is polled every frame, otherwise the loop sleeps until woken
+        if (m_changePending || m_changeApplied || m_sceneLoader->busy())
+            m_idleScheduler->wake();
+        m_parked = m_idleScheduler->parkIfIdle();
+
+        TRACE_SPAN("EditorManager::update");
+
+        // The previous frame was the first one showing the changes
+        if (m_changeApplied) {
+            auto latency = std::chrono::steady_clock::now() - m_changeTime;
+            m_reloadLatency.add(latency);
+            LOGI("Reload latency %lld ms, p50 %lld ms, p90 %lld ms",
+                 (long long)std::chrono::duration_cast<std::chrono::milliseconds>(latency).count(),
+                 (long long)std::chrono::duration_cast<std::chrono::milliseconds>(m_reloadLatency.percentile(0.5)).count(),
+                 (long long)std::chrono::duration_cast<std::chrono::milliseconds>(m_reloadLatency.percentile(0.9)).count());
+            m_changeApplied = false;
+            m_changePending = false;
+        }
+
+        for (const auto& result : m_buildScheduler->takeResults()) {
+            if (result.exitStatus == 0 && !result.cancelled) {
+                for (const auto& changedPath : m_resourceCache->sync())
+                    LOGI("Resource changed: %s", changedPath.c_str());
+            } else if (!result.cancelled && result.kind == BuildScheduler::JobKind::Build) {
+                // The library won't change, the source change is never shown
+                m_changePending = false;
+            }
+            auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(result.duration).count();
+            if (result.cancelled)
+                LOGI("flappy %s restarted after %lld ms", BuildScheduler::scriptName(result.kind), (long long)milliseconds);
+            else if (result.exitStatus == 0)
+                LOGI("flappy %s succeeded in %lld ms", BuildScheduler::scriptName(result.kind), (long long)milliseconds);
+            else
+                LOGE("flappy %s failed (%d) in %lld ms", BuildScheduler::scriptName(result.kind), result.exitStatus, (long long)milliseconds);
+        }
+
+        for (const auto& result : m_sceneSaver->takeResults()) {
+            auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(result.duration).count();
+            if (result.succeeded)
+                LOGI("Saved %s (%zu bytes) in %lld ms", result.path.c_str(), result.size, (long long)milliseconds);
+            else
+                LOGE("Can't save %s", result.path.c_str());
+        }
+
+        // Edits are saved at most once an autosave interval
+        if (m_editHistory.undoCount() + m_editHistory.redoCount() == 0) {
+            // Just loaded, the interval starts with the first edit
+            m_savedDocument = m_editHistory.document();
+            m_lastSaveTime = std::chrono::steady_clock::now();
+        } else if (m_autosaveInterval.count() > 0 && m_editHistory.document().root() != m_savedDocument.root()) {
+            auto autosaveTime = m_lastSaveTime + m_autosaveInterval;
+            if (std::chrono::steady_clock::now() >= autosaveTime)
+                saveScene();
+            else
+                m_idleScheduler->wakeAt(autosaveTime);
         }
+
         std::string fullScenePath = projectPath + "/" + m_scenePath;
-        if (m_sceneSelected) {
-            if (fileMonitor->exists(fullScenePath) && fileMonitor->changed(fullScenePath)) {
-                m_projectRoot.reset();
+        bool libraryChanged = false;
+        bool sceneChanged = false;
+        bool prefabChanged = false;
+        if (m_fileWatcher) {
+            std::vector<FileWatcher::Change> changes;
+            {
+                std::lock_guard<std::mutex> lock(m_fileChangesMutex);
+                changes.swap(m_fileChanges);
+            }
+            auto normalizedScenePath = FileWatcher::normalizePath(fullScenePath);
+            for (const auto& change : changes) {
+                if (change.kind == FileWatcher::ChangeKind::Scene && PrefabRegistry::instance().invalidate(change.path)) {
+                    prefabChanged = true;
+                    noteChange(change.time);
+                }
+                if (change.kind == FileWatcher::ChangeKind::Scene && change.path != normalizedScenePath) {
+                    for (const auto& cachedPath : m_sceneCache->scenePaths()) {
+                        if (FileWatcher::normalizePath(projectPath + "/" + cachedPath) == change.path)
+                            m_sceneCache->erase(cachedPath);
+                    }
+                }
+                bool isSceneChange = change.kind == FileWatcher::ChangeKind::Scene && change.path == normalizedScenePath;
+                libraryChanged |= change.kind == FileWatcher::ChangeKind::Library;
+                sceneChanged |= isSceneChange;
+                if (change.kind == FileWatcher::ChangeKind::Source || change.kind == FileWatcher::ChangeKind::Library || isSceneChange)
+                    noteChange(change.time);
+            }
+        } else {
+            auto fileMonitor = manager<IFileMonitorManager>();
+            libraryChanged = fileMonitor->exists(libraryPath) && fileMonitor->changed(libraryPath);
+            sceneChanged = m_sceneSelected && fileMonitor->exists(fullScenePath) && fileMonitor->changed(fullScenePath);
+            for (const auto& cachedPath : m_sceneCache->scenePaths()) {
+                auto fullCachedPath = projectPath + "/" + cachedPath;
+                if (!fileMonitor->exists(fullCachedPath) || fileMonitor->changed(fullCachedPath))
+                    m_sceneCache->erase(cachedPath);
+            }
+            if (libraryChanged || sceneChanged)
+                noteChange(std::chrono::steady_clock::now());
+        }
+
+        if (libraryChanged) {
+            m_libraryLoaded = false;
+        }
+        if (prefabChanged) {
+            // Any cached scene may contain instances of the prefab
+            m_sceneCache->clear();
+        }
+        if (m_sceneSelected && (sceneChanged || prefabChanged)) {
+            // Instances of a changed prefab look the same in the scene file, they can't be patched
+            if (!prefabChanged && m_sceneCreated && patchScene(fullScenePath)) {
+                m_changeApplied = m_changePending;
+            } else {
+                m_librarySnapshot.reset();
+                // A background load keeps showing the current scene until the new one is ready
+                if (!m_backgroundLoading)
+                    resetProjectRoot();
+                m_sceneLoader->cancel();
                 m_sceneLoaded = false;
                 m_sceneCreated = false;
+                m_sceneLoadFailed = false;
             }
         }
         if (!m_libraryLoaded) {
             try {
-                m_projectRoot.reset();
+                if (m_sceneCreated)
+                    m_librarySnapshot = std::make_unique<SceneSnapshot>(projectManager()->saveSnapshot());
+                resetProjectRoot();
+                m_sceneLoader->wait();
+                m_sceneCache->dropLiveScenes();
                 m_sceneCreated = false;
+                m_sceneLoadFailed = false;
+                // Cached methods point into the library that is about to be unloaded
+                PropertyRegistry::instance().clear();
+                TRACE_SPAN("RTTRService::loadLibrary", "library");
                 RTTRService::instance().loadLibrary(libraryPath);
                 m_libraryLoaded = true;
             } catch (const std::exception& e) {
                 LOGE("Can't load library. %s", e.what());
             }
         }
+        if (m_backgroundLoading) {
+            if (m_libraryLoaded && m_sceneSelected && !m_sceneCreated) {
+                m_sceneCreated = loadSceneInBackground(projectPath, fullScenePath);
+                m_changeApplied = m_sceneCreated && m_changePending;
+            }
+            return;
+        }
+        if (!m_sceneLoaded && m_sceneSelected && !m_retainSceneTree) {
+            // The scene is streamed straight from the file when it's created
+            m_serializedTree = nullptr;
+            m_sceneLoaded = true;
+        }
         if (!m_sceneLoaded && m_sceneSelected) {
             try {
+                TRACE_SPAN("EditorManager::loadSceneFile", "scene");
                 auto sceneFileText = manager<IFileLoadManager>()->loadTextFile(fullScenePath);
                 m_serializedTree = nlohmann::json::parse(sceneFileText);
                 m_sceneLoaded = true;
@@ -116,12 +277,31 @@ EditorManager::EditorManager(const std::string& projectPath)
                 LOGE("Can't load scene. %s", e.what());
             }
         }
-        if (m_libraryLoaded && m_sceneLoaded && !m_sceneCreated)
-            m_sceneCreated = createScene(projectPath, m_serializedTree);
+        if (m_libraryLoaded && m_sceneLoaded && !m_sceneCreated) {
+            m_sceneCreated = createScene(projectPath, fullScenePath);
+            m_changeApplied = m_sceneCreated && m_changePending;
+        }
     });
 
     events()->subscribe([this, libraryPath](DeinitEvent) {
-        m_projectRoot.reset();
+        if (!m_tracePath.empty()) {
+            auto parkedMs = std::chrono::duration_cast<std::chrono::milliseconds>(m_idleScheduler->parkedTime()).count();
+            nlohmann::json otherData = {{"reloadLatency", m_reloadLatency.toJson()}, {"droppedSpans", Tracer::instance().droppedCount()}, {"parkedMs", parkedMs}};
+            if (Tracer::instance().exportChromeTrace(m_tracePath, otherData))
+                LOGI("Trace is written to %s", m_tracePath.c_str());
+            else
+                LOGE("Can't write trace to %s", m_tracePath.c_str());
+        }
+        m_fileWatcher.reset();
+        m_sceneLoader->wait();
+        // Edits made since the last autosave are written before the saver stops
+        if (m_sceneCreated && m_editHistory.document().root() != m_savedDocument.root())
+            saveScene();
+        m_sceneSaver->flush();
+        m_sceneCache->clear();
+        m_librarySnapshot.reset();
+        resetProjectRoot();
+        m_resourceCache.reset();
         m_libraryLoaded = false;
         m_sceneLoaded = false;
         m_sceneCreated = false;
@@ -133,21 +313,273 @@ flappy::SafePtr<ProjectManager> EditorManager::projectManager() {
 }
 
 void EditorManager::selectScene(const std::string &scenePath) {
-    m_scenePath = scenePath;
+    if (m_sceneSelected && scenePath == m_scenePath)
+        return;
+    m_sceneLoader->cancel();
+    m_librarySnapshot.reset();
+
+    // The current scene is kept dormant, it receives no events while cached
+    if (m_sceneSelected) {
+        // The cache may drop the live tree and its history later, unsaved edits are saved first
+        bool edited = m_sceneCreated && m_editHistory.document().root() != m_savedDocument.root();
+        if (edited)
+            saveScene();
+        SceneCache::Entry entry;
+        if (m_sceneLoaded)
+            entry.tree = edited ? m_editHistory.document().toJson() : std::move(m_serializedTree);
+        if (m_sceneCreated && m_projectRoot) {
+            entry.projectRoot = m_projectRoot;
+            entry.projectRoutes = m_projectRoutes;
+            entry.editHistory = std::move(m_editHistory);
+        }
+        m_sceneCache->put(m_scenePath, std::move(entry));
+    }
+    resetProjectRoot();
+    m_serializedTree = nullptr;
+    m_editHistory.reset(SceneDocument());
     m_sceneLoaded = false;
+    m_sceneCreated = false;
+
+    SceneCache::Entry entry;
+    if (m_sceneCache->take(scenePath, entry)) {
+        if (!entry.tree.is_null()) {
+            m_serializedTree = std::move(entry.tree);
+            m_sceneLoaded = true;
+        }
+        if (entry.projectRoot) {
+            m_projectRoot = std::move(entry.projectRoot);
+            m_projectRoutes = std::move(entry.projectRoutes);
+            m_editHistory = std::move(entry.editHistory);
+            m_sceneCreated = true;
+        }
+    }
+
+    m_scenePath = scenePath;
+    m_savedSceneHash = 0;
     m_sceneSelected = true;
+    m_idleScheduler->wake();
+    m_sceneLoadFailed = false;
+}
+
+void EditorManager::noteChange(std::chrono::steady_clock::time_point time) {
+    if (!m_changePending || time < m_changeTime)
+        m_changeTime = time;
+    m_changePending = true;
+}
+
+void EditorManager::setTracePath(const std::string& tracePath) {
+    m_tracePath = tracePath;
+    Tracer::instance().setEnabled(!tracePath.empty());
 }
 
-bool EditorManager::createScene(const std::string& projectPath, const nlohmann::json& jsonTree) {
+void EditorManager::resetProjectRoot() {
+    m_projectRoutes.reset();
+    m_projectRoot.reset();
+}
+
+void EditorManager::setRetainSceneTree(bool retain) {
+    if (m_retainSceneTree == retain)
+        return;
+    m_retainSceneTree = retain;
+    m_sceneLoader->cancel();
+    // Cached scenes were loaded with the other setting
+    m_sceneCache->clear();
+    m_sceneLoaded = false;
+    m_sceneLoadFailed = false;
+}
+
+bool EditorManager::startFileWatcher(const std::string& projectPath, const std::string& libraryPath) {
+    auto fileWatcher = std::make_unique<FileWatcher>();
+    fileWatcher->watchDirectory(projectPath + "/src", FileWatcher::ChangeKind::Source);
+    fileWatcher->watchDirectory(projectPath + "/flappy_conf", FileWatcher::ChangeKind::Source);
+    fileWatcher->watchDirectory(projectPath + "/res_src", FileWatcher::ChangeKind::Resource);
+    fileWatcher->watchFile(libraryPath, FileWatcher::ChangeKind::Library);
+    auto buildScheduler = m_buildScheduler;
+    fileWatcher->subscribe([this, buildScheduler](const std::vector<FileWatcher::Change>& changes) {
+        for (const auto& change : changes) {
+            if (change.kind == FileWatcher::ChangeKind::Source)
+                buildScheduler->request(BuildScheduler::JobKind::Build);
+            else if (change.kind == FileWatcher::ChangeKind::Resource || change.kind == FileWatcher::ChangeKind::Scene)
+                buildScheduler->request(BuildScheduler::JobKind::PackRes);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_fileChangesMutex);
+            m_fileChanges.insert(m_fileChanges.end(), changes.begin(), changes.end());
+        }
+        m_idleScheduler->wake();
+    });
+    if (!fileWatcher->start()) {
+        LOGI("File watcher is not available, falling back to fswatch");
+        return false;
+    }
+    m_fileWatcher = std::move(fileWatcher);
+    return true;
+}
+
+void EditorManager::setAutosaveInterval(std::chrono::milliseconds interval) {
+    m_autosaveInterval = interval;
+}
+
+void EditorManager::setBuildDebounce(std::chrono::milliseconds debounce) {
+    m_buildScheduler->setDebounce(debounce);
+}
+
+void EditorManager::setParallelLoading(bool parallel) {
+    m_parallelLoading = parallel;
+}
+
+void EditorManager::setBackgroundLoading(bool background) {
+    if (m_backgroundLoading == background)
+        return;
+    m_backgroundLoading = background;
+    m_sceneLoader->cancel();
+    m_sceneLoadFailed = false;
+}
+
+std::shared_ptr<Entity> EditorManager::createProjectRoot(const std::string& projectPath) {
+    auto projectRoot = std::make_shared<Entity>();
+    for (auto managerPair : managers())
+        projectRoot->events()->post(ManagerAddedEvent(managerPair.second));
+    for (const auto& resourceManager : m_resourceCache->managers())
+        projectRoot->events()->post(ManagerAddedEvent(resourceManager));
+    projectRoot->createComponent<ProjectManager>(projectPath, false);
+    return projectRoot;
+}
+
+bool EditorManager::createScene(const std::string& projectPath, const std::string& fullScenePath) {
+    TRACE_SPAN("EditorManager::createScene", "scene");
     try {
-        m_projectRoot = std::make_shared<Entity>();
-        for (auto managerPair : managers())
-            m_projectRoot->events()->post(ManagerAddedEvent(managerPair.second));
-        auto manager = m_projectRoot->createComponent<ProjectManager>(projectPath);
-        manager->loadFromJson(jsonTree);
+        m_projectRoot = createProjectRoot(projectPath);
+        auto manager = m_projectRoot->manager<ProjectManager>();
+        m_projectRoutes = manager->eventRoutes();
+        // Edits aren't in the scene file, the library reload recreates the edited scene
+        bool keepHistory = m_librarySnapshot && m_editHistory.undoCount() + m_editHistory.redoCount() > 0;
+        if (keepHistory) {
+            manager->loadFromJson(m_editHistory.document().toJson(), m_parallelLoading ? &ThreadPool::shared() : nullptr);
+        } else if (m_retainSceneTree) {
+            manager->loadFromJson(m_serializedTree, m_parallelLoading ? &ThreadPool::shared() : nullptr);
+        } else {
+            std::ifstream sceneStream(fullScenePath);
+            if (!sceneStream)
+                throw std::runtime_error("Can't open " + fullScenePath);
+            manager->loadFromStream(sceneStream);
+        }
+        if (!keepHistory)
+            m_editHistory.reset(SceneDocument::fromJson(m_retainSceneTree ? m_serializedTree : manager->entityToJson(ScenePath())));
+        if (m_librarySnapshot) {
+            manager->restoreSnapshot(*m_librarySnapshot);
+            m_librarySnapshot.reset();
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("Can't load. %s", e.what());
+        return false;
+    }
+}
+
+bool EditorManager::patchScene(const std::string& fullScenePath) {
+    TRACE_SPAN("EditorManager::patchScene", "scene");
+    try {
+        auto sceneFileText = manager<IFileLoadManager>()->loadTextFile(fullScenePath);
+        // Saved by the editor, the scene already shows it
+        if (m_savedSceneHash != 0 && std::hash<std::string>()(sceneFileText) == m_savedSceneHash) {
+            if (m_retainSceneTree && m_editHistory.undoCount() + m_editHistory.redoCount() == 0)
+                m_serializedTree = nlohmann::json::parse(sceneFileText);
+            return true;
+        }
+        // Nothing to diff against
+        if (!m_retainSceneTree)
+            return false;
+        auto newTree = nlohmann::json::parse(sceneFileText);
+        // The live tree is diffed as it's edited, the history can't be replayed over the new file
+        if (m_editHistory.undoCount() + m_editHistory.redoCount() > 0)
+            projectManager()->patchFromJson(m_editHistory.document().toJson(), newTree);
+        else
+            projectManager()->patchFromJson(m_serializedTree, newTree);
+        m_editHistory.reset(SceneDocument::fromJson(newTree));
+        m_serializedTree = std::move(newTree);
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("Can't patch scene, reloading. %s", e.what());
+        return false;
+    }
+}
+
+bool EditorManager::saveScene() {
+    TRACE_SPAN("EditorManager::saveScene", "scene");
+    if (!m_sceneCreated || m_scenePath.empty())
+        return false;
+    // A failed save is retried an interval later
+    m_lastSaveTime = std::chrono::steady_clock::now();
+    try {
+        auto text = projectManager()->saveToText();
+        m_savedDocument = m_editHistory.document();
+        auto textHash = std::hash<std::string>()(text);
+        // Already in the file
+        if (textHash == m_savedSceneHash)
+            return true;
+        m_savedSceneHash = textHash;
+        m_sceneSaver->save(m_projectPath + "/" + m_scenePath, std::move(text));
+        return true;
+    } catch (const std::exception& e) {
+        LOGE("Can't save scene. %s", e.what());
+        return false;
+    }
+}
+
+bool EditorManager::loadSceneInBackground(const std::string& projectPath, const std::string& fullScenePath) {
+    BackgroundSceneLoader::Result result;
+    if (!m_sceneLoader->takeResult(result)) {
+        if (m_sceneLoader->busy() || m_sceneLoadFailed)
+            return false;
+        BackgroundSceneLoader::Request request;
+        request.scenePath = fullScenePath;
+        request.retainTree = m_retainSceneTree;
+        // Edits aren't in the scene file, the library reload recreates the edited scene
+        m_loadKeepsHistory = m_librarySnapshot && m_editHistory.undoCount() + m_editHistory.redoCount() > 0;
+        if (m_loadKeepsHistory) {
+            request.tree = m_editHistory.document().toJson();
+        } else if (m_sceneLoaded && m_retainSceneTree) {
+            // Comes back with the result
+            request.tree = std::move(m_serializedTree);
+            m_sceneLoaded = false;
+        }
+        m_sceneLoader->start(std::move(request));
+        return false;
+    }
+    if (!result.error.empty()) {
+        LOGE("Can't load scene. %s", result.error.c_str());
+        m_sceneLoadFailed = true;
+        return false;
+    }
+
+    TRACE_SPAN("EditorManager::swapInScene", "scene");
+    try {
+        auto projectRoot = createProjectRoot(projectPath);
+        auto manager = projectRoot->manager<ProjectManager>();
+        if (!result.tree.is_null()) {
+            manager->loadFromJson(result.tree, m_parallelLoading ? &ThreadPool::shared() : nullptr);
+        } else {
+            std::istringstream sceneStream(result.text);
+            manager->loadFromStream(sceneStream);
+        }
+        if (m_librarySnapshot) {
+            manager->restoreSnapshot(*m_librarySnapshot);
+            m_librarySnapshot.reset();
+        }
+        if (!m_loadKeepsHistory && m_retainSceneTree) {
+            m_serializedTree = std::move(result.tree);
+            m_sceneLoaded = true;
+            m_editHistory.reset(result.document);
+        } else if (!m_loadKeepsHistory) {
+            m_editHistory.reset(SceneDocument::fromJson(manager->entityToJson(ScenePath())));
+        }
+        m_projectRoutes = manager->eventRoutes();
+        m_projectRoot = std::move(projectRoot);
         return true;
     } catch (const std::exception& e) {
         LOGE("Can't load. %s", e.what());
+        m_sceneLoadFailed = true;
         return false;
     }
 }
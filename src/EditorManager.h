@@ -1,12 +1,28 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <json/json.hpp>
 
 #include <Manager.h>
 
+#include "EditHistory.h"
+#include "EventRoutes.h"
+#include "FileWatcher.h"
+#include "SceneSnapshot.h"
+#include "Trace.h"
+
+class BackgroundSceneLoader;
+class BuildScheduler;
+class IdleScheduler;
 class ProjectManager;
+class ResourceCache;
+class SceneBenchmark;
+class SceneCache;
+class SceneSaver;
 
 class EditorManager : public flappy::Manager<EditorManager> {
 public:
@@ -14,17 +30,121 @@ public:
 
     flappy::SafePtr<ProjectManager> projectManager();
 
+    /// The previous scene is kept in sceneCache(), selecting it again reuses
+    /// its parsed or instantiated tree
     void selectScene(const std::string& scenePath);
 
+    SceneCache& sceneCache() { return *m_sceneCache; }
+
+    /// Keep the parsed scene document, which is needed to patch the scene on
+    /// file change. Without it the scene is streamed from the file and a file
+    /// change rebuilds the whole scene.
+    void setRetainSceneTree(bool retain);
+
+    /// Create child subtrees of a scene on worker threads. Requires the scene
+    /// document, a streamed scene is always created on the calling thread.
+    void setParallelLoading(bool parallel);
+
+    /// Read and parse the scene on the thread pool, the current scene is
+    /// shown meanwhile. Entities are created on the editor thread, the new
+    /// scene is swapped in within a single frame.
+    void setBackgroundLoading(bool background);
+
+    /// Quiet period after the last file change before a build is started
+    void setBuildDebounce(std::chrono::milliseconds debounce);
+
+    /// Enables tracing, the trace is written to tracePath in the Chrome trace
+    /// format when the editor is deinitialized
+    void setTracePath(const std::string& tracePath);
+
+    /// Undo/redo of edits made to projectManager(). The history is kept
+    /// across project library reloads and dropped when the scene is loaded
+    /// again from its file.
+    EditHistory& editHistory() { return m_editHistory; }
+
+    /// Serializes the scene on the editor thread, writing again only the
+    /// text of components whose values changed since the last save, and
+    /// writes the file on a worker thread. The file change caused by the
+    /// save doesn't reload the scene.
+    bool saveScene();
+
+    /// Edits in editHistory() are saved once the interval since the last
+    /// save has passed. Zero turns autosave off.
+    void setAutosaveInterval(std::chrono::milliseconds interval);
+
+    /// Decides when the editor loop sleeps, see IdleScheduler. Wake it or
+    /// request frames after changing the scene from outside the editor.
+    IdleScheduler& idleScheduler() { return *m_idleScheduler; }
+
+    /// Time from a file change to the first frame showing the rebuilt or patched scene
+    const LatencyHistogram& reloadLatency() const { return m_reloadLatency; }
+
 private:
+    /// Drives the private load and reload paths directly
+    friend class SceneBenchmark;
+
+    std::shared_ptr<BuildScheduler> m_buildScheduler;
+    /// Shared with watch threads and the build worker, which wake it
+    std::shared_ptr<IdleScheduler> m_idleScheduler;
+    std::unique_ptr<BackgroundSceneLoader> m_sceneLoader;
+    std::unique_ptr<SceneSaver> m_sceneSaver;
+    /// Resource managers lent to every scene, outlives m_projectRoot
+    std::unique_ptr<ResourceCache> m_resourceCache;
     std::shared_ptr<flappy::Entity> m_projectRoot;
+    /// Routes of the ProjectManager in m_projectRoot
+    std::shared_ptr<EventRoutes> m_projectRoutes;
+    /// Recently selected scenes, outlived by m_resourceCache too
+    std::unique_ptr<SceneCache> m_sceneCache;
+    std::string m_projectPath;
     std::string m_scenePath;
+    /// Hash of the text last saved to the scene file, to recognize its change
+    size_t m_savedSceneHash = 0;
+    /// Version of the edited scene last saved or loaded
+    SceneDocument m_savedDocument;
+    std::chrono::steady_clock::duration m_autosaveInterval = std::chrono::seconds(10);
+    std::chrono::steady_clock::time_point m_lastSaveTime;
     nlohmann::json m_serializedTree;
+    /// State of the scene taken before the project library is reloaded
+    std::unique_ptr<SceneSnapshot> m_librarySnapshot;
+    EditHistory m_editHistory;
 
     bool m_libraryLoaded = false;
     bool m_sceneLoaded = false;
     bool m_sceneSelected = false;
     bool m_sceneCreated = false;
+    bool m_retainSceneTree = true;
+    bool m_parallelLoading = false;
+    bool m_backgroundLoading = true;
+    /// The scene isn't loaded again until something changes
+    bool m_sceneLoadFailed = false;
+    /// The running load recreates the edited scene after a library reload
+    bool m_loadKeepsHistory = false;
+
+    /// The loop was parked during the last frame, see IdleScheduler
+    bool m_parked = false;
+    float m_lastFrameTime = 0.0f;
+
+    std::string m_tracePath;
+    LatencyHistogram m_reloadLatency;
+    /// Earliest file change the shown scene doesn't reflect yet
+    bool m_changePending = false;
+    std::chrono::steady_clock::time_point m_changeTime;
+    /// The scene is updated, latency is taken on the next frame
+    bool m_changeApplied = false;
+
+    /// Filled on the watcher thread, consumed on UpdateEvent
+    std::mutex m_fileChangesMutex;
+    std::vector<FileWatcher::Change> m_fileChanges;
+    /// Declared after the changes it writes to, so it's stopped first
+    std::unique_ptr<FileWatcher> m_fileWatcher;
 
-    bool createScene(const std::string &projectPath, const nlohmann::json& jsonTree);
+    void resetProjectRoot();
+    void noteChange(std::chrono::steady_clock::time_point time);
+    /// Empty project tree with the editor and resource managers posted to it
+    std::shared_ptr<flappy::Entity> createProjectRoot(const std::string& projectPath);
+    bool createScene(const std::string& projectPath, const std::string& fullScenePath);
+    bool patchScene(const std::string& fullScenePath);
+    /// Starts or polls the background load, returns true once the scene is swapped in
+    bool loadSceneInBackground(const std::string& projectPath, const std::string& fullScenePath);
+    bool startFileWatcher(const std::string& projectPath, const std::string& libraryPath);
 };
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <Manager.h>
+
+/// Event types forwarded into a nested tree. The owner of the tree declares
+/// the types its components and managers consume with consume(), other
+/// events stop at the first level. Blocked types are never forwarded,
+/// InitEvent is blocked by default, a nested tree is initialized on its own.
+///
+/// Trees whose consumers can't declare their types fall back to
+/// forwardUndeclared(), everything not blocked is forwarded then.
+/// The tables are short, a linear search beats hashing here.
+class EventRoutes {
+public:
+    EventRoutes() {
+        block<flappy::InitEvent>();
+    }
+
+    template <typename EventT>
+    void consume() {
+        consume(flappy::GetTypeId<flappy::EventHandle, EventT>::value());
+    }
+
+    void consume(flappy::TypeId<flappy::EventHandle> id) {
+        if (std::find(m_consumedIds.begin(), m_consumedIds.end(), id) == m_consumedIds.end())
+            m_consumedIds.push_back(id);
+    }
+
+    template <typename EventT>
+    void block() {
+        block(flappy::GetTypeId<flappy::EventHandle, EventT>::value());
+    }
+
+    void block(flappy::TypeId<flappy::EventHandle> id) {
+        if (std::find(m_blockedIds.begin(), m_blockedIds.end(), id) == m_blockedIds.end())
+            m_blockedIds.push_back(id);
+    }
+
+    template <typename EventT>
+    void unblock() {
+        auto id = flappy::GetTypeId<flappy::EventHandle, EventT>::value();
+        m_blockedIds.erase(std::remove(m_blockedIds.begin(), m_blockedIds.end(), id), m_blockedIds.end());
+    }
+
+    void setForwardUndeclared(bool forward) { m_forwardUndeclared = forward; }
+    bool forwardUndeclared() const { return m_forwardUndeclared; }
+
+    bool forwards(flappy::TypeId<flappy::EventHandle> id) const {
+        if (std::find(m_blockedIds.begin(), m_blockedIds.end(), id) != m_blockedIds.end())
+            return false;
+        return m_forwardUndeclared || std::find(m_consumedIds.begin(), m_consumedIds.end(), id) != m_consumedIds.end();
+    }
+
+private:
+    std::vector<flappy::TypeId<flappy::EventHandle>> m_consumedIds;
+    std::vector<flappy::TypeId<flappy::EventHandle>> m_blockedIds;
+    bool m_forwardUndeclared = false;
+};
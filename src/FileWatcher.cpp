@@ -0,0 +1,233 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+#include <unordered_set>
+
+#include "Trace.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher()
+{}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (m_thread.joinable()) {
+        char stop = 0;
+        if (write(m_stopPipe[1], &stop, 1) < 0) {
+            // The loop also stops when the pipe is closed
+        }
+        m_thread.join();
+    }
+    for (auto fd : {m_inotifyFd, m_stopPipe[0], m_stopPipe[1]}) {
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+}
+
+std::string FileWatcher::normalizePath(const std::string& path) {
+    std::stringstream result;
+    std::stringstream stream(path);
+    std::string segment;
+    bool first = true;
+    if (!path.empty() && path[0] == '/')
+        result << '/';
+    while (std::getline(stream, segment, '/')) {
+        if (segment.empty() || segment == ".")
+            continue;
+        if (!first)
+            result << '/';
+        result << segment;
+        first = false;
+    }
+    return result.str();
+}
+
+void FileWatcher::watchDirectory(const std::string& path, ChangeKind kind) {
+    m_directories.push_back({normalizePath(path), kind, true, false});
+}
+
+void FileWatcher::watchFile(const std::string& path, ChangeKind kind) {
+    m_files.push_back({normalizePath(path), kind, false});
+}
+
+void FileWatcher::subscribe(Callback callback) {
+    m_callbacks.push_back(std::move(callback));
+}
+
+#ifdef __linux__
+
+static const uint32_t watchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+bool FileWatcher::start() {
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0)
+        return false;
+    if (pipe(m_stopPipe) != 0)
+        return false;
+    for (const auto& directory : m_directories)
+        addDirectory(directory.path, directory.kind, true);
+    registerFileWatches();
+    m_thread = std::thread([this]() { watcherLoop(); });
+    return true;
+}
+
+void FileWatcher::addDirectory(const std::string& path, ChangeKind kind, bool recursive) {
+    int wd = inotify_add_watch(m_inotifyFd, path.c_str(), watchMask | IN_ONLYDIR);
+    if (wd < 0)
+        return;
+    m_watches[wd] = {path, kind, recursive, false};
+    if (!recursive)
+        return;
+    auto dir = opendir(path.c_str());
+    if (dir == nullptr)
+        return;
+    while (auto entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (entry->d_type == DT_DIR && name != "." && name != "..")
+            addDirectory(path + "/" + name, kind, true);
+    }
+    closedir(dir);
+}
+
+void FileWatcher::registerFileWatches() {
+    for (auto& file : m_files) {
+        if (file.registered)
+            continue;
+        auto slashPos = file.path.find_last_of('/');
+        auto directory = slashPos == std::string::npos ? std::string(".") : file.path.substr(0, slashPos);
+        int wd = inotify_add_watch(m_inotifyFd, directory.c_str(), watchMask | IN_ONLYDIR);
+        if (wd < 0)
+            continue;
+        // A directory which is watched as a whole already reports the file
+        if (m_watches.find(wd) == m_watches.end())
+            m_watches[wd] = {directory, file.kind, false, true};
+        file.registered = true;
+    }
+}
+
+bool FileWatcher::classify(const Watch& watch, const std::string& path, bool isDirectory, ChangeKind& kind) const {
+    for (const auto& file : m_files) {
+        if (file.path == path) {
+            kind = file.kind;
+            return true;
+        }
+    }
+    if (watch.filesOnly || isDirectory)
+        return false;
+    kind = watch.kind;
+    static const std::string sceneExtension = ".scene";
+    if (kind == ChangeKind::Resource && path.size() > sceneExtension.size()
+            && path.compare(path.size() - sceneExtension.size(), sceneExtension.size(), sceneExtension) == 0)
+        kind = ChangeKind::Scene;
+    return true;
+}
+
+void FileWatcher::watcherLoop() {
+    using Clock = std::chrono::steady_clock;
+    alignas(inotify_event) char buffer[64 * 1024];
+    std::vector<Change> batch;
+    std::unordered_set<std::string> batchPaths;
+    Clock::time_point batchDeadline;
+    Tracer::instance().setThreadName("FileWatcher");
+
+    auto addChange = [&batch, &batchPaths, &batchDeadline, this](ChangeKind kind, const std::string& path) {
+        if (!batchPaths.insert(path).second)
+            return;
+        if (batch.empty())
+            batchDeadline = Clock::now() + m_batchWindow;
+        batch.push_back({kind, path, Clock::now()});
+    };
+
+    while (true) {
+        int timeout = 1000;
+        if (!batch.empty()) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(batchDeadline - Clock::now());
+            timeout = std::max(0, static_cast<int>(remaining.count()));
+        }
+        pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_stopPipe[0], POLLIN, 0}};
+        int ready = poll(fds, 2, timeout);
+        if (ready < 0 && errno != EINTR)
+            return;
+        if (fds[1].revents != 0)
+            return;
+
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            TRACE_SPAN("FileWatcher::readEvents", "watch");
+            ssize_t length;
+            while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* ptr = buffer; ptr < buffer + length; ) {
+                    auto event = reinterpret_cast<const inotify_event*>(ptr);
+                    ptr += sizeof(inotify_event) + event->len;
+
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        // Events are lost, report everything as changed
+                        for (const auto& file : m_files)
+                            addChange(file.kind, file.path);
+                        for (const auto& directory : m_directories)
+                            addChange(directory.kind, directory.path);
+                        continue;
+                    }
+                    auto watchIter = m_watches.find(event->wd);
+                    if (watchIter == m_watches.end())
+                        continue;
+                    if (event->mask & IN_IGNORED) {
+                        for (auto& file : m_files) {
+                            if (file.path.compare(0, watchIter->second.path.size() + 1, watchIter->second.path + "/") == 0)
+                                file.registered = false;
+                        }
+                        m_watches.erase(watchIter);
+                        continue;
+                    }
+                    auto watch = watchIter->second;
+                    bool isDirectory = (event->mask & IN_ISDIR) != 0;
+                    auto path = event->len > 0 ? watch.path + "/" + event->name : watch.path;
+                    if (isDirectory && watch.recursive && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                        addDirectory(path, watch.kind, true);
+                    // A new file is reported once it is written, not while it's still empty
+                    if (!isDirectory && (event->mask & IN_CREATE))
+                        continue;
+                    ChangeKind kind;
+                    if (classify(watch, path, isDirectory, kind))
+                        addChange(kind, path);
+                }
+            }
+        }
+
+        registerFileWatches();
+
+        if (!batch.empty() && Clock::now() >= batchDeadline) {
+            TRACE_SPAN("FileWatcher::deliver", "watch");
+            for (const auto& callback : m_callbacks)
+                callback(batch);
+            batch.clear();
+            batchPaths.clear();
+        }
+    }
+}
+
+#else
+
+bool FileWatcher::start() {
+    return false;
+}
+
+void FileWatcher::addDirectory(const std::string&, ChangeKind, bool) {}
+
+void FileWatcher::registerFileWatches() {}
+
+void FileWatcher::watcherLoop() {}
+
+bool FileWatcher::classify(const Watch&, const std::string&, bool, ChangeKind&) const {
+    return false;
+}
+
+#endif
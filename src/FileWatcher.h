@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// Watches project directories in-process and delivers classified changes in
+/// batches. Uses inotify, on other platforms start() fails and the caller has
+/// to fall back to polling.
+class FileWatcher {
+public:
+    enum class ChangeKind {
+        Source,
+        Resource,
+        Scene,
+        Library
+    };
+
+    struct Change {
+        ChangeKind kind;
+        std::string path;
+        /// When the watcher saw the change
+        std::chrono::steady_clock::time_point time;
+    };
+
+    /// Called on the watcher thread
+    using Callback = std::function<void(const std::vector<Change>&)>;
+
+    FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    ~FileWatcher();
+
+    /// Removes "." segments and repeated slashes, so paths can be compared
+    static std::string normalizePath(const std::string& path);
+
+    /// Changes of files under the directory and all its subdirectories.
+    /// Files with the .scene extension are reported as ChangeKind::Scene.
+    void watchDirectory(const std::string& path, ChangeKind kind);
+    /// A single file, its directory may appear later
+    void watchFile(const std::string& path, ChangeKind kind);
+    void subscribe(Callback callback);
+
+    /// Must be called after all watches and subscriptions are set
+    bool start();
+
+private:
+    struct Watch {
+        std::string path;
+        ChangeKind kind;
+        bool recursive;
+        /// Parent directory of watched files, other files are ignored
+        bool filesOnly;
+    };
+
+    struct FileWatch {
+        std::string path;
+        ChangeKind kind;
+        bool registered;
+    };
+
+    std::vector<Watch> m_directories;
+    std::vector<FileWatch> m_files;
+    std::vector<Callback> m_callbacks;
+    std::unordered_map<int, Watch> m_watches;
+    int m_inotifyFd = -1;
+    int m_stopPipe[2] = {-1, -1};
+    std::thread m_thread;
+    std::chrono::milliseconds m_batchWindow {50};
+
+    void addDirectory(const std::string& path, ChangeKind kind, bool recursive);
+    void registerFileWatches();
+    void watcherLoop();
+    bool classify(const Watch& watch, const std::string& path, bool isDirectory, ChangeKind& kind) const;
+};
@@ -0,0 +1,109 @@
+#include "IdleScheduler.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+IdleScheduler::IdleScheduler()
+    : m_awakeUntil(Clock::now() + m_quietPeriod)
+{}
+
+void IdleScheduler::setQuietPeriod(Clock::duration quietPeriod) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quietPeriod = quietPeriod;
+}
+
+void IdleScheduler::setMaxParkTime(Clock::duration maxParkTime) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxParkTime = maxParkTime;
+}
+
+void IdleScheduler::setWaiter(std::function<bool(Clock::duration)> wait, std::function<void()> interrupt) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wait = std::move(wait);
+    m_interrupt = std::move(interrupt);
+}
+
+void IdleScheduler::setSimulateContinuously(bool continuous) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_continuous = continuous;
+    }
+    awake(Clock::now());
+}
+
+bool IdleScheduler::simulatesContinuously() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_continuous;
+}
+
+void IdleScheduler::wake() {
+    Clock::duration quietPeriod;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        quietPeriod = m_quietPeriod;
+    }
+    awake(Clock::now() + quietPeriod);
+}
+
+void IdleScheduler::requestFrames(Clock::duration duration) {
+    awake(Clock::now() + duration);
+}
+
+void IdleScheduler::wakeAt(Clock::time_point time) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_wakeTime == Clock::time_point() || time < m_wakeTime)
+        m_wakeTime = time;
+}
+
+void IdleScheduler::awake(Clock::time_point until) {
+    std::function<void()> interrupt;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakeRequested = true;
+        m_awakeUntil = std::max(m_awakeUntil, until);
+        // Frames calling wake() don't flood the waiter with interrupts
+        if (m_waiting && m_interrupt) {
+            interrupt = m_interrupt;
+            m_waiting = false;
+        }
+    }
+    m_condition.notify_all();
+    if (interrupt)
+        interrupt();
+}
+
+bool IdleScheduler::parkIfIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wakeRequested = false;
+    if (m_continuous || Clock::now() < m_awakeUntil)
+        return false;
+
+    TRACE_SPAN("IdleScheduler::park");
+    auto parkStart = Clock::now();
+    auto parkTime = m_maxParkTime;
+    if (m_wakeTime != Clock::time_point()) {
+        parkTime = std::min(parkTime, std::max(Clock::duration(0), m_wakeTime - parkStart));
+        m_wakeTime = Clock::time_point();
+    }
+    if (m_wait) {
+        auto wait = m_wait;
+        m_waiting = true;
+        lock.unlock();
+        bool input = wait(parkTime);
+        lock.lock();
+        m_waiting = false;
+        if (input && !m_wakeRequested)
+            m_awakeUntil = Clock::now() + m_quietPeriod;
+    } else {
+        m_condition.wait_for(lock, parkTime, [this]() { return m_wakeRequested || m_continuous; });
+    }
+    m_wakeRequested = false;
+    m_parkedTime += Clock::now() - parkStart;
+    return true;
+}
+
+IdleScheduler::Clock::duration IdleScheduler::parkedTime() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_parkedTime;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+/// Parks the editor loop while nothing changes. After a quiet period
+/// without activity parkIfIdle() blocks the frame until wake() is called
+/// from any thread, frames are requested or input arrives.
+///
+/// Scenes animated by their own components need every frame, for them
+/// the loop can be kept running with setSimulateContinuously().
+class IdleScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    IdleScheduler();
+
+    /// Frames keep running this long after the last activity
+    void setQuietPeriod(Clock::duration quietPeriod);
+
+    /// A parked loop runs a frame at least this often
+    void setMaxParkTime(Clock::duration maxParkTime);
+
+    /// The parked loop blocks in wait, which returns true once input is
+    /// waiting or false after the timeout. interrupt is called from any
+    /// thread by wake() and must make the blocked wait return. Without a
+    /// waiter the loop sleeps on a condition variable and input is only
+    /// seen by the next frame.
+    void setWaiter(std::function<bool(Clock::duration timeout)> wait, std::function<void()> interrupt);
+
+    void setSimulateContinuously(bool continuous);
+    bool simulatesContinuously();
+
+    /// Thread safe. Something changed, frames run for the quiet period.
+    void wake();
+
+    /// Thread safe. Frames run for at least duration, e.g. for an animation.
+    void requestFrames(Clock::duration duration);
+
+    /// Called on the loop thread, a park ends by time. Runs a frame then,
+    /// e.g. for a timer.
+    void wakeAt(Clock::time_point time);
+
+    /// Called on the loop thread once a frame. Returns true if it parked.
+    bool parkIfIdle();
+
+    /// Total time the loop was parked
+    Clock::duration parkedTime();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    Clock::duration m_quietPeriod = std::chrono::milliseconds(500);
+    Clock::duration m_maxParkTime = std::chrono::seconds(1);
+    std::function<bool(Clock::duration)> m_wait;
+    std::function<void()> m_interrupt;
+    bool m_continuous = false;
+    bool m_wakeRequested = false;
+    /// The loop is blocked in m_wait, which is interrupted at most once
+    bool m_waiting = false;
+    Clock::time_point m_awakeUntil;
+    /// Earliest wakeAt() time, the epoch if there is none
+    Clock::time_point m_wakeTime;
+    Clock::duration m_parkedTime {0};
+
+    void awake(Clock::time_point until);
+};
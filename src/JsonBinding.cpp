@@ -0,0 +1,153 @@
+#include "JsonBinding.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "Property.h"
+
+using json = nlohmann::json;
+
+ValueKind valueKind(rttr::type type) {
+    if (type == rttr::type::get<int>())
+        return ValueKind::Int;
+    if (type == rttr::type::get<unsigned int>())
+        return ValueKind::UnsignedInt;
+    if (type == rttr::type::get<int64_t>())
+        return ValueKind::Int64;
+    if (type == rttr::type::get<uint64_t>())
+        return ValueKind::UnsignedInt64;
+    if (type == rttr::type::get<float>())
+        return ValueKind::Float;
+    if (type == rttr::type::get<double>())
+        return ValueKind::Double;
+    if (type == rttr::type::get<bool>())
+        return ValueKind::Bool;
+    if (type == rttr::type::get<std::string>())
+        return ValueKind::String;
+    if (type.is_enumeration())
+        return ValueKind::Enum;
+    if (type.is_sequential_container())
+        return ValueKind::Sequence;
+    // TODO: Handle pointers
+    // TODO: Handle associative containers
+    if (type.is_class() && !type.is_wrapper() && !type.is_pointer())
+        return ValueKind::Structure;
+    return ValueKind::Unsupported;
+}
+
+static void assignEnum(const json& value, rttr::type type, rttr::variant& target) {
+    auto enumeration = type.get_enumeration();
+    if (value.is_string()) {
+        auto enumValue = enumeration.name_to_value(value.get_ref<const std::string&>());
+        if (!enumValue.is_valid())
+            throw std::runtime_error("Unknown enum value " + value.get<std::string>());
+        target = enumValue;
+        return;
+    }
+    auto number = value.get<int64_t>();
+    for (const auto& enumValue : enumeration.get_values()) {
+        if (enumValue.to_int64() == number) {
+            target = enumValue;
+            return;
+        }
+    }
+    throw std::runtime_error("Unknown enum value " + std::to_string(number));
+}
+
+static void assignSequence(const json& value, rttr::variant& target) {
+    if (!value.is_array())
+        throw std::runtime_error("Array expected");
+    auto view = target.create_sequential_view();
+    if (!view.is_valid() || !view.set_size(value.size()))
+        throw std::runtime_error("Can't resize " + target.get_type().get_name().to_string());
+    auto itemType = view.get_value_type();
+    auto itemKind = valueKind(itemType);
+    for (size_t i = 0; i < value.size(); i++) {
+        auto item = view.get_value(i).extract_wrapped_value();
+        assignJson(value[i], itemType, itemKind, item);
+        view.set_value(i, item);
+    }
+}
+
+static void assignStructure(const json& value, rttr::type type, rttr::variant& target) {
+    if (!value.is_object())
+        throw std::runtime_error("Object expected");
+    if (!target.is_valid())
+        throw std::runtime_error("No instance of " + type.get_name().to_string());
+    // Setter/getter pairs, the same way as components are described
+    auto properties = PropertyRegistry::instance().propertyList(type);
+    for (const auto& property : *properties) {
+        auto fieldIter = value.find(property.name());
+        if (fieldIter != value.end())
+            property.setValue(target, *fieldIter);
+    }
+    // Plain fields
+    for (auto rttrProperty : type.get_properties()) {
+        auto fieldIter = value.find(rttrProperty.get_name().to_string());
+        if (fieldIter == value.end())
+            continue;
+        auto field = rttrProperty.get_value(target);
+        assignJson(*fieldIter, rttrProperty.get_type(), field);
+        rttrProperty.set_value(target, field);
+    }
+}
+
+void assignJson(const json& value, rttr::type type, ValueKind kind, rttr::variant& target) {
+    switch (kind) {
+    case ValueKind::Int: target = value.get<int>(); break;
+    case ValueKind::UnsignedInt: target = value.get<unsigned int>(); break;
+    case ValueKind::Int64: target = value.get<int64_t>(); break;
+    case ValueKind::UnsignedInt64: target = value.get<uint64_t>(); break;
+    case ValueKind::Float: target = value.get<float>(); break;
+    case ValueKind::Double: target = value.get<double>(); break;
+    case ValueKind::Bool: target = value.get<bool>(); break;
+    case ValueKind::String: target = value.get<std::string>(); break;
+    case ValueKind::Enum: assignEnum(value, type, target); break;
+    case ValueKind::Sequence: assignSequence(value, target); break;
+    case ValueKind::Structure: assignStructure(value, type, target); break;
+    case ValueKind::Unsupported:
+        throw std::runtime_error("Unsupported type " + type.get_name().to_string());
+    }
+}
+
+json variantToJson(const rttr::variant& value) {
+    auto type = value.get_type();
+    if (type.is_wrapper())
+        return variantToJson(value.extract_wrapped_value());
+    switch (valueKind(type)) {
+    case ValueKind::Int: return value.get_value<int>();
+    case ValueKind::UnsignedInt: return value.get_value<unsigned int>();
+    case ValueKind::Int64: return value.get_value<int64_t>();
+    case ValueKind::UnsignedInt64: return value.get_value<uint64_t>();
+    case ValueKind::Float: return value.get_value<float>();
+    case ValueKind::Double: return value.get_value<double>();
+    case ValueKind::Bool: return value.get_value<bool>();
+    case ValueKind::String: return value.get_value<std::string>();
+    case ValueKind::Enum: {
+        auto name = type.get_enumeration().value_to_name(value);
+        if (!name.empty())
+            return name.to_string();
+        return value.to_int64();
+    }
+    case ValueKind::Sequence: {
+        json result = json::array();
+        auto view = value.create_sequential_view();
+        for (const auto& item : view)
+            result.push_back(variantToJson(item.extract_wrapped_value()));
+        return result;
+    }
+    case ValueKind::Structure: {
+        json result = json::object();
+        auto instance = value;
+        auto properties = PropertyRegistry::instance().propertyList(type);
+        for (const auto& property : *properties)
+            result[property.name()] = property.getValue(instance);
+        for (auto rttrProperty : type.get_properties())
+            result[rttrProperty.get_name().to_string()] = variantToJson(rttrProperty.get_value(instance));
+        return result;
+    }
+    case ValueKind::Unsupported:
+        break;
+    }
+    throw std::runtime_error("Unsupported type " + type.get_name().to_string());
+}
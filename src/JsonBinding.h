@@ -0,0 +1,34 @@
+#pragma once
+
+#include <json/json.hpp>
+
+#include <RTTRService.h>
+
+/// How a value of a reflected type is represented in json.
+enum class ValueKind {
+    Unsupported,
+    Int,
+    UnsignedInt,
+    Int64,
+    UnsignedInt64,
+    Float,
+    Double,
+    Bool,
+    String,
+    Enum,
+    Sequence,
+    Structure
+};
+
+ValueKind valueKind(rttr::type type);
+
+/// Converts a json node to a value of the given type. Primitives and enums
+/// are written to target directly. Sequences and structures are updated in
+/// place, so target must already hold a value of the type (e.g. a getter result).
+void assignJson(const nlohmann::json& value, rttr::type type, ValueKind kind, rttr::variant& target);
+
+inline void assignJson(const nlohmann::json& value, rttr::type type, rttr::variant& target) {
+    assignJson(value, type, valueKind(type), target);
+}
+
+nlohmann::json variantToJson(const rttr::variant& value);
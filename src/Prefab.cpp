@@ -0,0 +1,212 @@
+#include "Prefab.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "FileWatcher.h"
+
+using json = nlohmann::json;
+
+namespace Prefab {
+
+bool isInstance(const json& jsonEntity) {
+    auto prefabIter = jsonEntity.find("prefab");
+    return prefabIter != jsonEntity.end() && prefabIter->is_string();
+}
+
+const std::string& path(const json& jsonEntity) {
+    return jsonEntity["prefab"].get_ref<const std::string&>();
+}
+
+const json& overrides(const json& jsonEntity) {
+    static const json empty = json::array();
+    auto overridesIter = jsonEntity.find("overrides");
+    return overridesIter != jsonEntity.end() && overridesIter->is_array() ? *overridesIter : empty;
+}
+
+void applyOverrides(json& jsonEntity, const json& overrides) {
+    for (const auto& jsonOverride : overrides) {
+        auto entity = &jsonEntity;
+        auto pathIter = jsonOverride.find("entity");
+        bool found = true;
+        if (pathIter != jsonOverride.end() && pathIter->is_array()) {
+            for (const auto& index : *pathIter) {
+                auto entitiesIter = entity->find("entities");
+                found = entitiesIter != entity->end() && index.is_number_unsigned() && index.get<size_t>() < entitiesIter->size();
+                if (!found)
+                    break;
+                entity = &(*entitiesIter)[index.get<size_t>()];
+            }
+        }
+        auto componentsIter = entity->find("components");
+        auto componentIndex = jsonOverride.value("component", size_t(0));
+        auto valuesIter = jsonOverride.find("values");
+        if (!found || componentsIter == entity->end() || componentIndex >= componentsIter->size()
+                || valuesIter == jsonOverride.end() || !valuesIter->is_object())
+            continue;
+        auto& jsonComponent = (*componentsIter)[componentIndex];
+        for (auto valueIter = valuesIter->begin(); valueIter != valuesIter->end(); valueIter++)
+            jsonComponent[valueIter.key()] = valueIter.value();
+    }
+}
+
+static const json& arrayField(const json& jsonEntity, const char* key) {
+    static const json empty = json::array();
+    auto iter = jsonEntity.find(key);
+    return iter != jsonEntity.end() && iter->is_array() ? *iter : empty;
+}
+
+static bool sameStructure(const json& baseline, const json& expanded) {
+    const auto& baselineComponents = arrayField(baseline, "components");
+    const auto& expandedComponents = arrayField(expanded, "components");
+    if (baselineComponents.size() != expandedComponents.size())
+        return false;
+    for (size_t i = 0; i < baselineComponents.size(); i++) {
+        if (baselineComponents[i].value("type", std::string()) != expandedComponents[i].value("type", std::string()))
+            return false;
+    }
+    const auto& baselineEntities = arrayField(baseline, "entities");
+    const auto& expandedEntities = arrayField(expanded, "entities");
+    if (baselineEntities.size() != expandedEntities.size())
+        return false;
+    for (size_t i = 0; i < baselineEntities.size(); i++) {
+        if (!sameStructure(baselineEntities[i], expandedEntities[i]))
+            return false;
+    }
+    return true;
+}
+
+static void collectOverrides(const json& baseline, const json& expanded, json& entityPath, json& overrides) {
+    // Structures are the same, so arrays are matched by index
+    const auto& baselineComponents = arrayField(baseline, "components");
+    const auto& expandedComponents = arrayField(expanded, "components");
+    for (size_t i = 0; i < expandedComponents.size(); i++) {
+        const auto& baselineComponent = baselineComponents[i];
+        const auto& expandedComponent = expandedComponents[i];
+        if (baselineComponent == expandedComponent)
+            continue;
+        json values = json::object();
+        for (auto fieldIter = expandedComponent.begin(); fieldIter != expandedComponent.end(); fieldIter++) {
+            auto baselineIter = baselineComponent.find(fieldIter.key());
+            if (baselineIter == baselineComponent.end() || *baselineIter != fieldIter.value())
+                values[fieldIter.key()] = fieldIter.value();
+        }
+        if (values.empty())
+            continue;
+        json jsonOverride = { { "component", i }, { "values", std::move(values) } };
+        if (!entityPath.empty())
+            jsonOverride["entity"] = entityPath;
+        overrides.push_back(std::move(jsonOverride));
+    }
+    const auto& baselineEntities = arrayField(baseline, "entities");
+    const auto& expandedEntities = arrayField(expanded, "entities");
+    for (size_t i = 0; i < expandedEntities.size(); i++) {
+        entityPath.push_back(i);
+        collectOverrides(baselineEntities[i], expandedEntities[i], entityPath, overrides);
+        entityPath.erase(entityPath.size() - 1);
+    }
+}
+
+json compact(const std::string& prefabPath, const json& baseline, const json& expandedEntity) {
+    if (!sameStructure(baseline, expandedEntity))
+        return expandedEntity;
+    json jsonEntity = { { "prefab", prefabPath } };
+    json entityPath = json::array();
+    json overrides = json::array();
+    collectOverrides(baseline, expandedEntity, entityPath, overrides);
+    if (!overrides.empty())
+        jsonEntity["overrides"] = std::move(overrides);
+    return jsonEntity;
+}
+
+}
+
+PrefabRegistry& PrefabRegistry::instance() {
+    static PrefabRegistry registry;
+    return registry;
+}
+
+void PrefabRegistry::setBasePath(const std::string& basePath) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    if (m_basePath == basePath)
+        return;
+    m_basePath = basePath;
+    m_templates.clear();
+}
+
+std::string PrefabRegistry::fullPath(const std::string& prefabPath) const {
+    return FileWatcher::normalizePath(m_basePath.empty() ? prefabPath : m_basePath + "/" + prefabPath);
+}
+
+std::shared_ptr<const json> PrefabRegistry::prefabTemplate(const std::string& prefabPath) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    auto path = fullPath(prefabPath);
+    auto templateIter = m_templates.find(path);
+    if (templateIter != m_templates.end())
+        return templateIter->second.tree;
+
+    if (std::find(m_resolving.begin(), m_resolving.end(), path) != m_resolving.end())
+        throw std::runtime_error("Prefab includes itself: " + prefabPath);
+    std::ifstream stream(path);
+    if (!stream)
+        throw std::runtime_error("Can't open prefab " + path);
+    std::stringstream text;
+    text << stream.rdbuf();
+    auto tree = json::parse(text.str());
+
+    Template prefabTemplate;
+    prefabTemplate.files.insert(path);
+    m_resolving.push_back(path);
+    try {
+        expandEntity(tree, prefabTemplate.files);
+    } catch (...) {
+        m_resolving.pop_back();
+        throw;
+    }
+    m_resolving.pop_back();
+    prefabTemplate.tree = std::make_shared<const json>(std::move(tree));
+    return m_templates.emplace(path, std::move(prefabTemplate)).first->second.tree;
+}
+
+json PrefabRegistry::expand(const json& jsonEntity) {
+    auto expanded = *prefabTemplate(Prefab::path(jsonEntity));
+    Prefab::applyOverrides(expanded, Prefab::overrides(jsonEntity));
+    return expanded;
+}
+
+void PrefabRegistry::expandEntity(json& jsonEntity, std::unordered_set<std::string>& files) {
+    if (Prefab::isInstance(jsonEntity)) {
+        auto prefabPath = Prefab::path(jsonEntity);
+        jsonEntity = expand(jsonEntity);
+        const auto& nestedFiles = m_templates.at(fullPath(prefabPath)).files;
+        files.insert(nestedFiles.begin(), nestedFiles.end());
+        return;
+    }
+    auto entitiesIter = jsonEntity.find("entities");
+    if (entitiesIter == jsonEntity.end() || !entitiesIter->is_array())
+        return;
+    for (auto& child : *entitiesIter)
+        expandEntity(child, files);
+}
+
+bool PrefabRegistry::invalidate(const std::string& changedPath) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    auto path = FileWatcher::normalizePath(changedPath);
+    bool used = false;
+    for (auto templateIter = m_templates.begin(); templateIter != m_templates.end();) {
+        if (templateIter->second.files.count(path) != 0) {
+            used = true;
+            templateIter = m_templates.erase(templateIter);
+        } else {
+            templateIter++;
+        }
+    }
+    return used;
+}
+
+void PrefabRegistry::clear() {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    m_templates.clear();
+}
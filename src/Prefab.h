@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <json/json.hpp>
+
+/// Prefab references in scene files. An entity of the form
+///
+///     { "prefab": "res_src/Prop.scene",
+///       "overrides": [ { "entity": [0], "component": 1, "values": { "size": 2 } } ] }
+///
+/// is an instance of the referenced scene, its own components and entities
+/// are ignored. An override sets values of a template component, "entity"
+/// is the path of child indices in the template and defaults to its root.
+namespace Prefab {
+
+bool isInstance(const nlohmann::json& jsonEntity);
+const std::string& path(const nlohmann::json& jsonEntity);
+const nlohmann::json& overrides(const nlohmann::json& jsonEntity);
+
+/// Sets override values in an expanded entity, wrong positions are skipped
+void applyOverrides(nlohmann::json& jsonEntity, const nlohmann::json& overrides);
+
+/// Instance of prefabPath carrying only the values that differ from the
+/// baseline, the serialized template. Returns expandedEntity if it's
+/// structurally different from the baseline, overrides can't describe that.
+nlohmann::json compact(const std::string& prefabPath, const nlohmann::json& baseline, const nlohmann::json& expandedEntity);
+
+}
+
+/// Process-wide cache of prefab templates. A template is read and parsed
+/// once and shared by every instance, nested prefabs are expanded in it.
+/// Template paths are relative to the base path, the project directory.
+class PrefabRegistry {
+public:
+    static PrefabRegistry& instance();
+
+    void setBasePath(const std::string& basePath);
+
+    /// Throws if the file can't be read or prefabs include each other
+    std::shared_ptr<const nlohmann::json> prefabTemplate(const std::string& prefabPath);
+
+    /// Instance with its template and overrides expanded
+    nlohmann::json expand(const nlohmann::json& jsonEntity);
+
+    /// Drops templates read from the changed file or including it. Returns
+    /// false if the file isn't used as a prefab.
+    bool invalidate(const std::string& changedPath);
+    void clear();
+
+private:
+    struct Template {
+        std::shared_ptr<const nlohmann::json> tree;
+        /// Normalized paths of the file and of all nested prefabs
+        std::unordered_set<std::string> files;
+    };
+
+    std::recursive_mutex m_mutex;
+    std::string m_basePath;
+    std::unordered_map<std::string, Template> m_templates;
+    /// Templates being expanded, to detect cycles
+    std::vector<std::string> m_resolving;
+
+    std::string fullPath(const std::string& prefabPath) const;
+    /// Expands nested instances in place, collecting their files
+    void expandEntity(nlohmann::json& jsonEntity, std::unordered_set<std::string>& files);
+};
@@ -1,129 +1,87 @@
 #include "ProjectManager.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
 #include <Entity.h>
 
-#include <StdFileLoadManager.h>
-#include <ResManager.h>
-#include <SpriteRes.h>
-#include <GLTextureResFactory.h>
-#include <SpriteResFactory.h>
-#include <GLRenderElementFactory.h>
-#include <GLShaderResFactory.h>
-#include <TextureRes.h>
-#include <FontRes.h>
-#include <FontResFactory.h>
-#include <GlyphSheetRes.h>
-#include <GlyphSheetResFactory.h>
-#include <Sdl2RgbaBitmapResFactory.h>
-#include <Sdl2RgbaBitmapRes.h>
-#include <StdFileMonitorManager.h>
-#include <ResRepositoryManager.h>
-#include <DefaultResFactory.h>
-#include <TextResFactory.h>
+#include "BinaryScene.h"
+#include "Prefab.h"
+#include "Property.h"
+#include "ResourceCache.h"
+#include "SceneArena.h"
+#include "SceneLoader.h"
+#include "Trace.h"
 
 using namespace flappy;
 using json = nlohmann::json;
+using namespace SceneLoader;
 
-// TODO: Move Property to a separate file
-class Property {
-public:
-    Property(rttr::method setter, rttr::method getter)
-        : m_setter(setter)
-        , m_getter(getter)
-    {}
-
-    void setValue(rttr::variant variant, const std::string& value) {
-        auto argumentInfos = m_setter.get_parameter_infos();
-        std::vector<rttr::argument> arguments;
-        std::string tmpStackStr;
-        if (argumentInfos.begin()->get_type() == rttr::type::get<int>())
-            arguments.push_back(rttr::argument(json::parse(value).get<int>()));
-        else if (argumentInfos.begin()->get_type() == rttr::type::get<float>())
-            arguments.push_back(rttr::argument(json::parse(value).get<float>()));
-        else if (argumentInfos.begin()->get_type() == rttr::type::get<double>())
-            arguments.push_back(rttr::argument(json::parse(value).get<double>()));
-        else if (argumentInfos.begin()->get_type() == rttr::type::get<bool>())
-            arguments.push_back(rttr::argument(json::parse(value).get<bool>()));
-        else if (argumentInfos.begin()->get_type() == rttr::type::get<std::string>()) {
-            tmpStackStr = json::parse(value).get<std::string>();
-            arguments.push_back(rttr::argument(tmpStackStr));
-        }
-        // TODO: Handle enums
-        // TODO: Handle pointers
-        // TODO: Handle serializable structures
-        m_setter.invoke_variadic(variant, arguments);
-    }
-    std::string getValue(rttr::variant variant) {
-        auto result = m_getter.invoke(variant);
-        auto type = result.get_type();
-        // FIXME: Spike to represent string in json format
-        if (type == rttr::type::get<std::string>())
-            return "\"" + result.to_string() + "\"";
-        else
-            return result.to_string();
-    }
-private:
-    rttr::method m_setter;
-    rttr::method m_getter;
-};
-
-static std::vector<rttr::method> findMethods(rttr::type componentType, std::string name, rttr::type returnType) {
-    for (auto method : componentType.get_methods()) {
-        if (method.get_return_type() == returnType && method.get_name() == name)
-            return {method};
-    }
-    return {};
-}
-
-// TODO: Make a constructor of PropertyList class
-static std::unordered_map<std::string, Property> scanProperties(rttr::type componentType) {
-    std::unordered_map<std::string, Property> properties;
-    for (auto method : componentType.get_methods()) {
-        auto args = method.get_parameter_infos();
-        auto methodName = method.get_name().to_string();
-        if (args.size() == 1 && methodName.substr(0, 3) == "set") {
-            auto argType = args.begin()->get_type();
-            auto getterName = methodName.substr(3);
-            getterName[0] = tolower(getterName[0]);
-            auto getterMethods = findMethods(componentType, getterName, argType);
-            if (getterMethods.size() == 1)
-                properties.emplace(getterName, Property(method, getterMethods[0]));
+/// Project libraries declare the event types their components consume with
+/// a global function registered in RTTR, returning the event type names
+static const char* const consumedEventsFunction = "flappyConsumedEvents";
+/// and the component types that change their own properties, whose values
+/// are read again on every save
+static const char* const rereadComponentsFunction = "flappyRereadComponents";
+
+static void declareProjectEvents(EventRoutes& routes) {
+    auto function = rttr::type::get_global_method(consumedEventsFunction);
+    if (function.is_valid()) {
+        auto names = function.invoke(rttr::instance());
+        if (names.is_type<std::vector<std::string>>()) {
+            for (const auto& name : names.get_value<std::vector<std::string>>())
+                routes.consume(TypeId<EventHandle>(name));
+            return;
         }
+        LOGE("%s must return std::vector<std::string>", consumedEventsFunction);
+    }
+    // Without a declaration the tree gets every event that isn't blocked
+    routes.setForwardUndeclared(true);
+}
+
+static void declareRereadComponents(ProjectManager& projectManager) {
+    auto function = rttr::type::get_global_method(rereadComponentsFunction);
+    if (!function.is_valid())
+        return;
+    auto names = function.invoke(rttr::instance());
+    if (!names.is_type<std::vector<std::string>>()) {
+        LOGE("%s must return std::vector<std::string>", rereadComponentsFunction);
+        return;
     }
-    return properties;
+    for (const auto& name : names.get_value<std::vector<std::string>>())
+        projectManager.rereadOnSave(TypeId<ComponentBase>(name));
 }
 
-ProjectManager::ProjectManager(const std::string& projectPath)
-    : m_root(std::make_shared<Entity>())
+ProjectManager::ProjectManager(const std::string& projectPath, bool createResources)
+    : m_root(std::make_unique<SceneNode>())
     , m_projectPath(projectPath)
+    , m_createResourceManagers(createResources)
+    , m_eventRoutes(std::make_shared<EventRoutes>())
+    , m_arena(std::make_shared<SceneArena>())
 {
     // TODO: Compose correct path to the lib
     auto libraryPath = projectPath + "/generated/cmake/build/libTestProject.dylib";
 
+    m_root->entity = std::make_shared<Entity>();
+
+    // Entities and managers of the loaded tree need these, the project library declares the rest
+    m_eventRoutes->consume<UpdateEvent>();
+    m_eventRoutes->consume<DeinitEvent>();
+    m_eventRoutes->consume<ManagerAddedEvent>();
+    m_eventRoutes->consume<ManagerRemovedEvent>();
+    declareProjectEvents(*m_eventRoutes);
+    declareRereadComponents(*this);
+
     events()->subscribe([this, libraryPath, projectPath](InitEvent) {
         // TODO: Compose correct path to resources
-        entity()->createComponent<ResRepositoryManager>(projectPath + "/generated/cmake/resources");
-        entity()->createComponent<TextResFactory>();
-        entity()->createComponent<ResManager<JsonRes>> ();
-        entity()->createComponent<DefaultResFactory<JsonRes, JsonRes, TextRes>>();
-        entity()->createComponent<GLTextureResFactory>();
-        entity()->createComponent<Sdl2RgbaBitmapResFactory> ();
-        entity()->createComponent<GLShaderResFactory> ();
-        entity()->createComponent<ResManager<ShaderRes>> ();
-        entity()->createComponent<ResManager<IRgbaBitmapRes>> ();
-        entity()->createComponent<ResManager<TextureRes>> ();
-        entity()->createComponent<ResManager<TextRes>> ();
-        entity()->createComponent<ResManager<GlyphSheetRes>> ();
-        entity()->createComponent<GlyphSheetResFactory>();
-        entity()->createComponent<ResManager<FontRes>> ();
-        entity()->createComponent<FontResFactory>();
-        entity()->createComponent<GLRenderElementFactory>();
+        if (m_createResourceManagers)
+            createResourceManagers(*entity(), projectPath + "/generated/cmake/resources");
     });
 
     events()->subscribeAll([this] (const EventHandle& eventHandle) {
-        // FIXME: Should check is event UpdateEvent
-        if (m_root && eventHandle.id() != GetTypeId<EventHandle, InitEvent>::value()) {
-            m_root->events()->post(eventHandle);
+        if (m_root && m_eventRoutes->forwards(eventHandle.id())) {
+            m_root->entity->events()->post(eventHandle);
         }
     });
 
@@ -132,108 +90,536 @@ ProjectManager::ProjectManager(const std::string& projectPath)
     });
 }
 
-static json serializeEntity(const SafePtr<Entity>& entity) {
-    if (!entity)
-        return {};
-    json jsonEntity;
-    std::vector<json> jsonComponents;
-    auto components = entity->findComponents<ComponentBase>();
-    for (auto component : components) {
-        json jsonComponent = { { "type", component->componentId().name() } };
+static const json& jsonArray(const json& jsonEntity, const char* key) {
+    static const json empty = json::array();
+    auto iter = jsonEntity.find(key);
+    return iter != jsonEntity.end() && iter->is_array() ? *iter : empty;
+}
 
-        try {
-            auto componentPointer = RTTRService::instance().toVariant(component);
-            auto componentType = componentPointer.get_type();
-            auto properties = scanProperties(componentType);
-            for (auto property : properties) {
-                try {
-                    std::string value = property.second.getValue(componentPointer);
-                    jsonComponent[property.first] = json::parse(value);
-                } catch (const std::exception& e) {
-                    LOGE("Can't parse. %s:%s. %s",
-                         component->componentId().name().c_str(),
-                         property.first.c_str(),
-                         e.what());
-                }
-            }
+static void removeComponent(SceneNode& node, size_t index) {
+    if (node.components[index] != nullptr)
+        node.entity->removeComponent(node.components[index]);
+    node.components[index] = nullptr;
+    if (index < node.unloadedComponents.size())
+        node.unloadedComponents[index] = nullptr;
+}
 
-            jsonComponents.push_back(jsonComponent);
-        } catch (const std::exception& e) {
-            LOGE("Can't serialize. %s. %s",
-                 component->componentId().name().c_str(),
-                 e.what());
+/// Creates the component at index, keeps its json if it can't be created
+static void replaceComponent(SceneNode& node, size_t index, const json& jsonComponent) {
+    removeComponent(node, index);
+    node.components[index] = loadComponent(*node.entity, jsonComponent);
+    if (node.components[index] == nullptr) {
+        node.unloadedComponents.resize(std::max(node.unloadedComponents.size(), index + 1));
+        node.unloadedComponents[index] = jsonComponent;
+    }
+}
+
+/// Json of the component that couldn't be created at index, nullptr for a created one
+static const json* unloadedComponent(const SceneNode& node, size_t index) {
+    if (index >= node.unloadedComponents.size() || node.unloadedComponents[index].is_null())
+        return nullptr;
+    return &node.unloadedComponents[index];
+}
+
+/// Returns whether the component was recreated
+static bool patchComponent(SceneNode& node, size_t index, const json& oldComponent, const json& newComponent) {
+    auto& component = node.components[index];
+    bool sameType = oldComponent.value("type", std::string()) == newComponent.value("type", std::string());
+    // A field can't be unset, so a component with removed fields is recreated to get defaults back
+    bool fieldRemoved = false;
+    for (auto fieldIter = oldComponent.begin(); fieldIter != oldComponent.end() && sameType; fieldIter++)
+        fieldRemoved |= newComponent.find(fieldIter.key()) == newComponent.end();
+
+    if (!sameType || fieldRemoved || component == nullptr) {
+        replaceComponent(node, index, newComponent);
+        return true;
+    }
+
+    json changedFields = json::object();
+    for (auto fieldIter = newComponent.begin(); fieldIter != newComponent.end(); fieldIter++) {
+        auto oldFieldIter = oldComponent.find(fieldIter.key());
+        if (oldFieldIter == oldComponent.end() || *oldFieldIter != fieldIter.value())
+            changedFields[fieldIter.key()] = fieldIter.value();
+    }
+    if (!changedFields.empty())
+        setProperties(component, changedFields);
+    return false;
+}
+
+/// Keeps index in step with the patched subtree
+static void patchEntity(SceneNode& node, const json& oldEntity, const json& newEntity, SceneIndex& index) {
+    const auto& oldComponents = jsonArray(oldEntity, "components");
+    const auto& newComponents = jsonArray(newEntity, "components");
+    if (oldComponents.size() != node.components.size())
+        throw std::runtime_error("Scene tree is out of sync with the json");
+    bool componentsPatched = false;
+    bool componentsReplaced = oldComponents.size() != newComponents.size();
+    for (size_t i = 0; i < newComponents.size() && i < oldComponents.size(); i++) {
+        if (oldComponents[i] != newComponents[i]) {
+            componentsPatched = true;
+            componentsReplaced |= patchComponent(node, i, oldComponents[i], newComponents[i]);
         }
     }
-    jsonEntity["components"] = jsonComponents;
-    auto nextEntities = entity->findEntities([](const auto&){ return true; });
-    std::vector<json> jsonEntities;
-    for (auto nextEntity : nextEntities) {
-        jsonEntity = serializeEntity(nextEntity);
-        jsonEntities.push_back(jsonEntity);
+    for (size_t i = newComponents.size(); i < oldComponents.size(); i++)
+        removeComponent(node, i);
+    node.components.resize(newComponents.size());
+    if (node.unloadedComponents.size() > newComponents.size())
+        node.unloadedComponents.resize(newComponents.size());
+    for (size_t i = oldComponents.size(); i < newComponents.size(); i++)
+        replaceComponent(node, i, newComponents[i]);
+    if (componentsPatched || componentsReplaced)
+        node.savedComponents.clear();
+    // Before the children, which are placed relative to the entity
+    if (componentsReplaced)
+        index.updateEntity(node);
+    else if (componentsPatched)
+        index.updatePosition(node);
+
+    const auto& oldEntities = jsonArray(oldEntity, "entities");
+    const auto& newEntities = jsonArray(newEntity, "entities");
+    if (oldEntities.size() != node.children.size())
+        throw std::runtime_error("Scene tree is out of sync with the json");
+    for (size_t i = 0; i < newEntities.size() && i < oldEntities.size(); i++) {
+        if (oldEntities[i] == newEntities[i])
+            continue;
+        if (!Prefab::isInstance(oldEntities[i]) && !Prefab::isInstance(newEntities[i])) {
+            patchEntity(*node.children[i], oldEntities[i], newEntities[i], index);
+            continue;
+        }
+        // Instances are compared by reference and overrides, a changed one is recreated
+        auto child = loadEntity(newEntities[i]);
+        node.entity->removeEntity(node.children[i]->entity);
+        index.removeEntity(*node.children[i]);
+        node.entity->addEntity(child->entity);
+        index.addEntity(node, *child);
+        node.children[i] = std::move(child);
+    }
+    for (size_t i = newEntities.size(); i < oldEntities.size(); i++) {
+        node.entity->removeEntity(node.children[i]->entity);
+        index.removeEntity(*node.children[i]);
+    }
+    node.children.resize(std::min(node.children.size(), newEntities.size()));
+    for (size_t i = oldEntities.size(); i < newEntities.size(); i++) {
+        auto child = loadEntity(newEntities[i]);
+        node.entity->addEntity(child->entity);
+        index.addEntity(node, *child);
+        node.children.push_back(std::move(child));
     }
-    jsonEntity["entities"] = jsonEntities;
-    return jsonEntity;
 }
 
-static std::shared_ptr<Entity> loadEntity(const json& jsonEntity) {
-    auto entity = std::make_shared<Entity>();
-    auto componentsIter = jsonEntity.find("components");
-    if (componentsIter != jsonEntity.end() && componentsIter->is_array()) {
-        for (auto jsonComponent : *componentsIter) {
+static SceneSnapshot::Layout propertyLayout(const PropertyList& properties) {
+    SceneSnapshot::Layout layout;
+    layout.reserve(properties.size());
+    for (const auto& property : properties)
+        layout.emplace_back(property.name(), property.type().get_name().to_string());
+    return layout;
+}
+
+static void snapshotEntity(const SceneNode& node, SceneSnapshot::Node& snapshotNode, SceneSnapshot& snapshot) {
+    snapshotNode.components.resize(node.components.size());
+    for (size_t i = 0; i < node.components.size(); i++) {
+        const auto& component = node.components[i];
+        if (component == nullptr)
+            continue;
+        auto& snapshotComponent = snapshotNode.components[i];
+        snapshotComponent.typeName = component->componentId().name();
+        auto componentPointer = RTTRService::instance().toVariant(component);
+        auto properties = PropertyRegistry::instance().propertyList(componentPointer.get_type());
+        if (snapshot.layouts.find(snapshotComponent.typeName) == snapshot.layouts.end())
+            snapshot.layouts.emplace(snapshotComponent.typeName, propertyLayout(*properties));
+        snapshotComponent.values.reserve(properties->size());
+        for (const auto& property : *properties) {
             try {
-                auto typeName = jsonComponent["type"].get<std::string>();
-                LOGI("type: %s", typeName.c_str());
-                auto typeId = TypeId<ComponentBase>(typeName);
-                auto component = RTTRService::instance().createComponent(typeId);
-                if (component != nullptr) {
-                    // TODO: Setup properties
-                    entity->addComponent(component);
-
-                    auto componentPointer = RTTRService::instance().toVariant(component);
-                    auto componentType = componentPointer.get_type();
-                    auto properties = scanProperties(componentType);
-                    for (auto propertyPair : properties)
-                        LOGI("property: %s", propertyPair.first.c_str());
-
-                    for (auto fieldIter = jsonComponent.begin(); fieldIter != jsonComponent.end(); fieldIter++) {
-                        try {
-                            if (fieldIter.key() != "type") {
-                                auto propertyIter = properties.find(fieldIter.key());
-                                if (propertyIter != properties.end()) {
-                                    propertyIter->second.setValue(componentPointer, fieldIter.value().dump());
-                                    LOGI("Property: %s", propertyIter->second.getValue(componentPointer).c_str());
-                                }
-                            }
-                        } catch (const std::exception& e) {
-                            LOGE("Can't parse. %s", e.what());
-                        }
-                    }
-                }
+                snapshotComponent.values.push_back(property.getValue(componentPointer));
             } catch (const std::exception& e) {
-                LOGE("Can't create component. %s", e.what());
+                snapshotComponent.values.push_back(nullptr);
             }
         }
     }
-    auto entitiesIter = jsonEntity.find("entities");
-    if (entitiesIter != jsonEntity.end() && entitiesIter->is_array()) {
-        for (auto nextJsonEntity : *entitiesIter) {
-            entity->addEntity(loadEntity(nextJsonEntity));
+    snapshotNode.children.resize(node.children.size());
+    for (size_t i = 0; i < node.children.size(); i++)
+        snapshotEntity(*node.children[i], snapshotNode.children[i], snapshot);
+}
+
+/// Maps property indices of a snapshot layout to indices of the reloaded type.
+using RestorePlan = std::vector<size_t>;
+
+static RestorePlan restorePlan(const SceneSnapshot::Layout& oldLayout, const PropertyList& properties) {
+    RestorePlan plan(oldLayout.size(), PropertyList::npos);
+    auto newLayout = propertyLayout(properties);
+    if (newLayout == oldLayout) {
+        // Fast path, layout is unchanged and values are restored by index
+        for (size_t i = 0; i < plan.size(); i++)
+            plan[i] = i;
+        return plan;
+    }
+    for (size_t i = 0; i < oldLayout.size(); i++) {
+        auto index = properties.indexOf(oldLayout[i].first);
+        if (index != PropertyList::npos && newLayout[index].second == oldLayout[i].second)
+            plan[i] = index;
+    }
+    return plan;
+}
+
+static void restoreEntity(SceneNode& node,
+                          const SceneSnapshot::Node& snapshotNode,
+                          const SceneSnapshot& snapshot,
+                          std::unordered_map<std::string, RestorePlan>& plans) {
+    for (size_t i = 0; i < node.components.size() && i < snapshotNode.components.size(); i++) {
+        const auto& component = node.components[i];
+        const auto& snapshotComponent = snapshotNode.components[i];
+        if (component == nullptr || component->componentId().name() != snapshotComponent.typeName)
+            continue;
+        auto componentPointer = RTTRService::instance().toVariant(component);
+        auto properties = PropertyRegistry::instance().propertyList(componentPointer.get_type());
+        auto planIter = plans.find(snapshotComponent.typeName);
+        if (planIter == plans.end()) {
+            const auto& layout = snapshot.layouts.at(snapshotComponent.typeName);
+            planIter = plans.emplace(snapshotComponent.typeName, restorePlan(layout, *properties)).first;
+        }
+        const auto& plan = planIter->second;
+        for (size_t valueIndex = 0; valueIndex < snapshotComponent.values.size(); valueIndex++) {
+            const auto& value = snapshotComponent.values[valueIndex];
+            if (plan[valueIndex] == PropertyList::npos || value.is_null())
+                continue;
+            try {
+                (*properties)[plan[valueIndex]].setValue(componentPointer, value);
+            } catch (const std::exception& e) {
+                LOGE("Can't restore. %s. %s", snapshotComponent.typeName.c_str(), e.what());
+            }
         }
     }
+    for (size_t i = 0; i < node.children.size() && i < snapshotNode.children.size(); i++)
+        restoreEntity(*node.children[i], snapshotNode.children[i], snapshot, plans);
+}
 
-    return entity;
+static SceneNode& sceneNode(SceneNode& root, const ScenePath& path) {
+    auto node = &root;
+    for (auto index : path)
+        node = node->children.at(index).get();
+    return *node;
 }
 
+/// Node which is about to change. Saved text of prefab instances on the
+/// way is dropped, they are saved as a whole.
+static SceneNode& changedSceneNode(SceneNode& root, const ScenePath& path, bool componentsChanged) {
+    auto node = &root;
+    for (auto index : path) {
+        if (!node->prefabPath.empty())
+            node->savedInstance = SavedText();
+        node = node->children.at(index).get();
+    }
+    if (componentsChanged)
+        node->savedComponents.clear();
+    if (componentsChanged || !node->prefabPath.empty())
+        node->savedInstance = SavedText();
+    return *node;
+}
 
-void ProjectManager::loadFromJson(const json& jsonTree) {
-    m_root = loadEntity(jsonTree);
+static void dropSavedText(SceneNode& node) {
+    node.savedComponents.clear();
+    node.savedInstance = SavedText();
+    for (auto& child : node.children)
+        dropSavedText(*child);
+}
+
+static const Property& findProperty(const std::shared_ptr<ComponentBase>& component,
+                                    const std::string& name,
+                                    rttr::variant& componentPointer,
+                                    std::shared_ptr<const PropertyList>& properties) {
+    if (component == nullptr)
+        throw std::runtime_error("Component isn't loaded");
+    componentPointer = RTTRService::instance().toVariant(component);
+    properties = PropertyRegistry::instance().propertyList(componentPointer.get_type());
+    auto index = properties->indexOf(name);
+    if (index == PropertyList::npos)
+        throw std::runtime_error("Unknown property " + name + " of " + component->componentId().name());
+    return (*properties)[index];
+}
+
+static json serializeComponent(const std::shared_ptr<ComponentBase>& component) {
+    json jsonComponent = { { "type", component->componentId().name() } };
+    auto componentPointer = RTTRService::instance().toVariant(component);
+    auto properties = PropertyRegistry::instance().propertyList(componentPointer.get_type());
+    for (const auto& property : *properties) {
+        try {
+            jsonComponent[property.name()] = property.getValue(componentPointer);
+        } catch (const std::exception& e) {
+            LOGE("Can't serialize. %s:%s. %s",
+                 component->componentId().name().c_str(),
+                 property.name().c_str(),
+                 e.what());
+        }
+    }
+    return jsonComponent;
+}
+
+/// Serialized prefab templates by path, built once per save
+using PrefabBaselines = std::unordered_map<std::string, json>;
+
+static json serializeNode(const SceneNode& node, PrefabBaselines& baselines);
+
+/// Instance with the values that differ from its template
+static json compactInstance(const std::string& prefabPath, const json& jsonEntity, PrefabBaselines& baselines) {
+    auto baselineIter = baselines.find(prefabPath);
+    if (baselineIter == baselines.end()) {
+        try {
+            // The template is compared as components report it, with unset values at their defaults
+            auto templateNode = loadEntity(*PrefabRegistry::instance().prefabTemplate(prefabPath));
+            baselineIter = baselines.emplace(prefabPath, serializeNode(*templateNode, baselines)).first;
+        } catch (const std::exception& e) {
+            LOGE("Can't load prefab %s, the instance is saved in full. %s", prefabPath.c_str(), e.what());
+            return jsonEntity;
+        }
+    }
+    return Prefab::compact(prefabPath, baselineIter->second, jsonEntity);
+}
+
+static json serializeNode(const SceneNode& node, PrefabBaselines& baselines) {
+    json jsonEntity = json::object();
+    auto jsonComponents = json::array();
+    for (size_t i = 0; i < node.components.size(); i++) {
+        if (node.components[i] != nullptr)
+            jsonComponents.push_back(serializeComponent(node.components[i]));
+        else if (auto jsonComponent = unloadedComponent(node, i))
+            jsonComponents.push_back(*jsonComponent);
+    }
+    if (!jsonComponents.empty())
+        jsonEntity["components"] = std::move(jsonComponents);
+    if (!node.children.empty()) {
+        auto& jsonEntities = jsonEntity["entities"] = json::array();
+        for (const auto& child : node.children)
+            jsonEntities.push_back(serializeNode(*child, baselines));
+    }
+    if (!node.prefabPath.empty())
+        return compactInstance(node.prefabPath, jsonEntity, baselines);
+    return jsonEntity;
+}
+
+/// Text of value, the saved one while the value is the same
+static const std::string& savedText(SavedText& saved, json value) {
+    if (saved.text.empty() || saved.value != value) {
+        saved.text = value.dump();
+        saved.value = std::move(value);
+    }
+    return saved.text;
+}
+
+using RereadTypes = std::vector<TypeId<ComponentBase>>;
+
+static bool rereads(const std::shared_ptr<ComponentBase>& component, const RereadTypes& rereadTypes) {
+    return component != nullptr
+        && std::find(rereadTypes.begin(), rereadTypes.end(), component->componentId()) != rereadTypes.end();
+}
+
+static bool subtreeRereads(const SceneNode& node, const RereadTypes& rereadTypes) {
+    if (rereadTypes.empty())
+        return false;
+    for (const auto& component : node.components) {
+        if (rereads(component, rereadTypes))
+            return true;
+    }
+    for (const auto& child : node.children) {
+        if (subtreeRereads(*child, rereadTypes))
+            return true;
+    }
+    return false;
+}
+
+/// Compact json text of the subtree, the same as serializeNode() dumps.
+/// Saved text is dropped by the edits of this manager and by markChanged(),
+/// only components without it and those of reread types are serialized.
+static void writeNode(SceneNode& node, PrefabBaselines& baselines, const RereadTypes& rereadTypes, std::string& text) {
+    if (!node.prefabPath.empty()) {
+        if (node.savedInstance.text.empty() || subtreeRereads(node, rereadTypes))
+            savedText(node.savedInstance, serializeNode(node, baselines));
+        text += node.savedInstance.text;
+        return;
+    }
+    node.savedComponents.resize(node.components.size());
+    text += '{';
+    bool hasComponents = false;
+    for (size_t i = 0; i < node.components.size(); i++) {
+        const auto& component = node.components[i];
+        auto jsonComponent = unloadedComponent(node, i);
+        if (component == nullptr && jsonComponent == nullptr)
+            continue;
+        text += hasComponents ? "," : "\"components\":[";
+        auto& saved = node.savedComponents[i];
+        if (saved.text.empty() || rereads(component, rereadTypes))
+            savedText(saved, component != nullptr ? serializeComponent(component) : *jsonComponent);
+        text += saved.text;
+        hasComponents = true;
+    }
+    if (hasComponents)
+        text += ']';
+    if (!node.children.empty()) {
+        text += hasComponents ? ",\"entities\":[" : "\"entities\":[";
+        for (size_t i = 0; i < node.children.size(); i++) {
+            if (i != 0)
+                text += ',';
+            writeNode(*node.children[i], baselines, rereadTypes, text);
+        }
+        text += ']';
+    }
+    text += '}';
+}
+
+void ProjectManager::loadFromJson(const json& jsonTree, ThreadPool* threadPool) {
+    TRACE_SPAN("ProjectManager::loadFromJson", "scene");
+    m_arena = std::make_shared<SceneArena>();
+    SceneArena::Scope arenaScope(m_arena);
+    m_root = threadPool != nullptr ? loadEntity(jsonTree, *threadPool) : loadEntity(jsonTree);
+    m_index.rebuild(*m_root);
 
     for (auto managerPair : managers()) {
         LOGI("ProjectManager Try send: %s", managerPair.second->componentId().name().c_str());
-        m_root->events()->post(ManagerAddedEvent(managerPair.second));
+        m_root->entity->events()->post(ManagerAddedEvent(managerPair.second));
     }
 }
 
+void ProjectManager::loadFromStream(std::istream& stream) {
+    TRACE_SPAN("ProjectManager::loadFromStream", "scene");
+    m_arena = std::make_shared<SceneArena>();
+    SceneArena::Scope arenaScope(m_arena);
+    m_root = loadEntity(stream);
+    m_index.rebuild(*m_root);
+
+    for (auto managerPair : managers())
+        m_root->entity->events()->post(ManagerAddedEvent(managerPair.second));
+}
+
+void ProjectManager::loadFromBinary(const std::string& path) {
+    TRACE_SPAN("ProjectManager::loadFromBinary", "scene");
+    m_arena = std::make_shared<SceneArena>();
+    SceneArena::Scope arenaScope(m_arena);
+    BinaryScene::MappedFile file(path);
+    BinaryScene::Reader reader(file.data(), file.size());
+    auto root = loadEntity(reader);
+    if (!reader.atEnd())
+        throw std::runtime_error("Trailing data in binary scene");
+    m_root = std::move(root);
+    m_index.rebuild(*m_root);
+
+    for (auto managerPair : managers())
+        m_root->entity->events()->post(ManagerAddedEvent(managerPair.second));
+}
+
+void ProjectManager::patchFromJson(const json& oldTree, const json& newTree) {
+    TRACE_SPAN("ProjectManager::patchFromJson", "scene");
+    SceneArena::Scope arenaScope(m_arena);
+    patchEntity(*m_root, oldTree, newTree, m_index);
+}
+
 nlohmann::json ProjectManager::saveToJson() {
-    return serializeEntity(m_root);
+    TRACE_SPAN("ProjectManager::saveToJson", "scene");
+    PrefabBaselines baselines;
+    return serializeNode(*m_root, baselines);
+}
+
+std::string ProjectManager::saveToText() {
+    TRACE_SPAN("ProjectManager::saveToText", "scene");
+    PrefabBaselines baselines;
+    std::string text;
+    writeNode(*m_root, baselines, m_rereadTypes, text);
+    return text;
+}
+
+void ProjectManager::markChanged(const ScenePath& path) {
+    m_index.updateEntity(changedSceneNode(*m_root, path, true));
+}
+
+void ProjectManager::markAllChanged() {
+    dropSavedText(*m_root);
+}
+
+SceneSnapshot ProjectManager::saveSnapshot() {
+    TRACE_SPAN("ProjectManager::saveSnapshot", "scene");
+    SceneSnapshot snapshot;
+    snapshotEntity(*m_root, snapshot.root, snapshot);
+    return snapshot;
+}
+
+void ProjectManager::restoreSnapshot(const SceneSnapshot& snapshot) {
+    TRACE_SPAN("ProjectManager::restoreSnapshot", "scene");
+    std::unordered_map<std::string, RestorePlan> plans;
+    restoreEntity(*m_root, snapshot.root, snapshot, plans);
+    dropSavedText(*m_root);
+    m_index.updatePositions();
+}
+
+json ProjectManager::propertyValue(const ScenePath& path, size_t componentIndex, const std::string& name) {
+    rttr::variant componentPointer;
+    std::shared_ptr<const PropertyList> properties;
+    const auto& component = sceneNode(*m_root, path).components.at(componentIndex);
+    return findProperty(component, name, componentPointer, properties).getValue(componentPointer);
+}
+
+void ProjectManager::setPropertyValue(const ScenePath& path, size_t componentIndex, const std::string& name, const json& value) {
+    rttr::variant componentPointer;
+    std::shared_ptr<const PropertyList> properties;
+    auto& node = changedSceneNode(*m_root, path, true);
+    const auto& component = node.components.at(componentIndex);
+    findProperty(component, name, componentPointer, properties).setValue(componentPointer, value);
+    m_index.updatePosition(node);
+}
+
+json ProjectManager::componentToJson(const ScenePath& path, size_t index) {
+    const auto& node = sceneNode(*m_root, path);
+    const auto& component = node.components.at(index);
+    if (component != nullptr)
+        return serializeComponent(component);
+    if (auto jsonComponent = unloadedComponent(node, index))
+        return *jsonComponent;
+    throw std::runtime_error("Component isn't loaded");
+}
+
+void ProjectManager::insertComponent(const ScenePath& path, size_t index, const json& jsonComponent) {
+    auto& node = changedSceneNode(*m_root, path, true);
+    if (index > node.components.size())
+        throw std::out_of_range("Component index is out of range");
+    auto component = loadComponent(*node.entity, jsonComponent);
+    // Unloaded components after index keep their positions
+    if (component == nullptr || index < node.unloadedComponents.size()) {
+        node.unloadedComponents.resize(std::max(node.unloadedComponents.size(), index));
+        node.unloadedComponents.insert(node.unloadedComponents.begin() + index, component == nullptr ? jsonComponent : json());
+    }
+    node.components.insert(node.components.begin() + index, std::move(component));
+    m_index.updateEntity(node);
+}
+
+void ProjectManager::eraseComponent(const ScenePath& path, size_t index) {
+    auto& node = changedSceneNode(*m_root, path, true);
+    if (index >= node.components.size())
+        throw std::out_of_range("Component index is out of range");
+    removeComponent(node, index);
+    node.components.erase(node.components.begin() + index);
+    if (index < node.unloadedComponents.size())
+        node.unloadedComponents.erase(node.unloadedComponents.begin() + index);
+    m_index.updateEntity(node);
+}
+
+json ProjectManager::entityToJson(const ScenePath& path) {
+    PrefabBaselines baselines;
+    return serializeNode(sceneNode(*m_root, path), baselines);
+}
+
+void ProjectManager::insertEntity(const ScenePath& parentPath, size_t index, const json& jsonEntity) {
+    auto& node = changedSceneNode(*m_root, parentPath, false);
+    if (index > node.children.size())
+        throw std::out_of_range("Entity index is out of range");
+    SceneArena::Scope arenaScope(m_arena);
+    auto child = loadEntity(jsonEntity);
+    node.entity->addEntity(child->entity);
+    m_index.addEntity(node, *child);
+    node.children.insert(node.children.begin() + index, std::move(child));
+}
+
+void ProjectManager::eraseEntity(const ScenePath& parentPath, size_t index) {
+    auto& node = changedSceneNode(*m_root, parentPath, false);
+    if (index >= node.children.size())
+        throw std::out_of_range("Entity index is out of range");
+    node.entity->removeEntity(node.children[index]->entity);
+    m_index.removeEntity(*node.children[index]);
+    node.children.erase(node.children.begin() + index);
 }
@@ -1,19 +1,96 @@
 #pragma once
 
+#include <algorithm>
+#include <istream>
+#include <vector>
+
 #include <json/json.hpp>
 
 #include <Manager.h>
 #include <RTTRService.h>
 
+#include "EventRoutes.h"
+#include "SceneArena.h"
+#include "SceneIndex.h"
+#include "SceneNode.h"
+#include "SceneSnapshot.h"
+#include "ThreadPool.h"
+
 class ProjectManager : public flappy::Manager<ProjectManager> {
 public:
-    ProjectManager(const std::string& projectPath);
+    /// Without own resource managers the project expects them to be provided
+    /// by the parent, e.g. by a ResourceCache.
+    ProjectManager(const std::string& projectPath, bool createResources = true);
+
+    /// With a thread pool child subtrees are created in parallel.
+    void loadFromJson(const nlohmann::json& jsonTree, ThreadPool* threadPool = nullptr);
+
+    /// Parses json text and creates entities on the fly, no document is built.
+    void loadFromStream(std::istream& stream);
+
+    /// Instantiates entities straight from a memory-mapped binary scene (see BinaryScene.h).
+    void loadFromBinary(const std::string& path);
 
-    void loadFromJson(const nlohmann::json& jsonTree);
+    /// Applies the difference between two versions of the loaded tree.
+    /// Only changed properties are set, untouched entities and components are kept alive.
+    void patchFromJson(const nlohmann::json& oldTree, const nlohmann::json& newTree);
 
     nlohmann::json saveToJson();
 
+    /// Compact json text of the tree. The text of components and instances
+    /// that weren't edited through this manager since the previous save is
+    /// reused, values of rereadOnSave() types are read every time.
+    std::string saveToText();
+    /// Components of the entity were changed, added or removed directly,
+    /// they are saved again and the entity is re-indexed in sceneIndex()
+    void markChanged(const ScenePath& path);
+    /// Drops the saved text, the next save writes everything again
+    void markAllChanged();
+    /// Components of the type change their own properties, their values are
+    /// compared on every save. Project libraries declare such types too.
+    void rereadOnSave(flappy::TypeId<flappy::ComponentBase> id) {
+        if (std::find(m_rereadTypes.begin(), m_rereadTypes.end(), id) == m_rereadTypes.end())
+            m_rereadTypes.push_back(id);
+    }
+
+    /// Component type and position lookups, updated as the tree is loaded
+    /// and edited through this manager
+    const SceneIndex& sceneIndex() const { return m_index; }
+    SceneIndex& sceneIndex() { return m_index; }
+
+    /// Live state of the tree, to be restored after the project library is reloaded.
+    SceneSnapshot saveSnapshot();
+    /// Restores values of components that still match the snapshot by position and type.
+    void restoreSnapshot(const SceneSnapshot& snapshot);
+
+    /// Event types forwarded into the loaded tree: updates, deinit, manager
+    /// changes and the types declared by the project library. A library
+    /// without the declaration gets every type but InitEvent.
+    std::shared_ptr<EventRoutes> eventRoutes() { return m_eventRoutes; }
+    /// Routes EventT into the loaded tree
+    template <typename EventT>
+    void consumeEvent() { m_eventRoutes->consume<EventT>(); }
+
+    /// Edits of the loaded tree. Entities and components are addressed by
+    /// their position in the scene file, a wrong position throws std::out_of_range.
+    nlohmann::json propertyValue(const ScenePath& path, size_t componentIndex, const std::string& name);
+    void setPropertyValue(const ScenePath& path, size_t componentIndex, const std::string& name, const nlohmann::json& value);
+    /// Component with all its properties, as it's written to a scene file
+    nlohmann::json componentToJson(const ScenePath& path, size_t index);
+    void insertComponent(const ScenePath& path, size_t index, const nlohmann::json& jsonComponent);
+    void eraseComponent(const ScenePath& path, size_t index);
+    nlohmann::json entityToJson(const ScenePath& path);
+    void insertEntity(const ScenePath& parentPath, size_t index, const nlohmann::json& jsonEntity);
+    void eraseEntity(const ScenePath& parentPath, size_t index);
+
 private:
-    std::shared_ptr<flappy::Entity> m_root;
+    std::unique_ptr<SceneNode> m_root;
     std::string m_projectPath;
+    bool m_createResourceManagers;
+    std::shared_ptr<EventRoutes> m_eventRoutes;
+    /// Entities of the loaded tree and of later edits. Every load starts a
+    /// new arena, the previous one is released with the last of its entities.
+    std::shared_ptr<SceneArena> m_arena;
+    SceneIndex m_index;
+    std::vector<flappy::TypeId<flappy::ComponentBase>> m_rereadTypes;
 };
@@ -0,0 +1,99 @@
+#include "Property.h"
+
+#include <algorithm>
+
+#include <json/json.hpp>
+
+using json = nlohmann::json;
+
+Property::Property(std::string name, rttr::method setter, rttr::method getter)
+    : m_name(std::move(name))
+    , m_setter(setter)
+    , m_getter(getter)
+    , m_type(getter.get_return_type())
+    , m_kind(valueKind(m_type))
+{}
+
+void Property::setValue(rttr::variant& instance, const json& value) const {
+    rttr::variant argument;
+    // Containers and structures are patched over the current value
+    if (m_kind == ValueKind::Sequence || m_kind == ValueKind::Structure)
+        argument = m_getter.invoke(instance);
+    assignJson(value, m_type, m_kind, argument);
+    m_setter.invoke(instance, argument);
+}
+
+json Property::getValue(rttr::variant& instance) const {
+    return variantToJson(m_getter.invoke(instance));
+}
+
+PropertyList::PropertyList(rttr::type type) {
+    // Single pass over methods to collect getter candidates, instead of
+    // a full method scan for every setter.
+    std::unordered_map<std::string, std::vector<rttr::method>> getters;
+    auto methods = type.get_methods();
+    for (auto method : methods) {
+        if (method.get_parameter_infos().size() == 0)
+            getters[method.get_name().to_string()].push_back(method);
+    }
+
+    for (auto method : methods) {
+        auto args = method.get_parameter_infos();
+        auto methodName = method.get_name().to_string();
+        if (args.size() == 1 && methodName.size() > 3 && methodName.compare(0, 3, "set") == 0) {
+            auto argType = args.begin()->get_type();
+            auto getterName = methodName.substr(3);
+            getterName[0] = tolower(getterName[0]);
+            auto gettersIter = getters.find(getterName);
+            if (gettersIter == getters.end())
+                continue;
+            for (auto getter : gettersIter->second) {
+                if (getter.get_return_type() == argType) {
+                    m_properties.emplace_back(getterName, method, getter);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::stable_sort(m_properties.begin(), m_properties.end(), [](const Property& a, const Property& b) {
+        return a.name() < b.name();
+    });
+    // Overloaded setters produce duplicates, keep the first one as before
+    m_properties.erase(std::unique(m_properties.begin(), m_properties.end(), [](const Property& a, const Property& b) {
+        return a.name() == b.name();
+    }), m_properties.end());
+}
+
+size_t PropertyList::indexOf(const std::string& name) const {
+    auto iter = std::lower_bound(m_properties.begin(), m_properties.end(), name, [](const Property& property, const std::string& name) {
+        return property.name() < name;
+    });
+    if (iter != m_properties.end() && iter->name() == name)
+        return static_cast<size_t>(iter - m_properties.begin());
+    return npos;
+}
+
+PropertyRegistry& PropertyRegistry::instance() {
+    static PropertyRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<const PropertyList> PropertyRegistry::propertyList(rttr::type type) {
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+        auto iter = m_propertyLists.find(type.get_id());
+        if (iter != m_propertyLists.end())
+            return iter->second;
+    }
+    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    auto& propertyList = m_propertyLists[type.get_id()];
+    if (!propertyList)
+        propertyList = std::make_shared<PropertyList>(type);
+    return propertyList;
+}
+
+void PropertyRegistry::clear() {
+    std::lock_guard<std::shared_timed_mutex> lock(m_mutex);
+    m_propertyLists.clear();
+}
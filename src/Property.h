@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.hpp>
+
+#include <RTTRService.h>
+
+#include "JsonBinding.h"
+
+/// Setter/getter pair of a component type, e.g. setValue(int)/value().
+class Property {
+public:
+    Property(std::string name, rttr::method setter, rttr::method getter);
+
+    const std::string& name() const { return m_name; }
+    rttr::type type() const { return m_type; }
+
+    void setValue(rttr::variant& instance, const nlohmann::json& value) const;
+    nlohmann::json getValue(rttr::variant& instance) const;
+
+private:
+    std::string m_name;
+    rttr::method m_setter;
+    rttr::method m_getter;
+    rttr::type m_type;
+    ValueKind m_kind;
+};
+
+/// All properties of a single type. Properties are sorted by name, so an index
+/// is stable for the lifetime of the list and the order matches the key order
+/// of json objects.
+class PropertyList {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit PropertyList(rttr::type type);
+
+    size_t size() const { return m_properties.size(); }
+    const Property& operator[](size_t index) const { return m_properties[index]; }
+    size_t indexOf(const std::string& name) const;
+
+    std::vector<Property>::const_iterator begin() const { return m_properties.begin(); }
+    std::vector<Property>::const_iterator end() const { return m_properties.end(); }
+
+private:
+    std::vector<Property> m_properties;
+};
+
+/// Process-wide cache of property lists. A list is built once per type and
+/// shared by every instance of the type. Must be cleared before the project
+/// library is reloaded, because cached methods point into the old library.
+/// Lookups of cached lists share the lock, so loader threads don't queue.
+class PropertyRegistry {
+public:
+    static PropertyRegistry& instance();
+
+    std::shared_ptr<const PropertyList> propertyList(rttr::type type);
+    void clear();
+
+private:
+    std::shared_timed_mutex m_mutex;
+    std::unordered_map<rttr::type::type_id, std::shared_ptr<const PropertyList>> m_propertyLists;
+};
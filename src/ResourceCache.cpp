@@ -0,0 +1,213 @@
+#include "ResourceCache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ResManager.h>
+#include <GLTextureResFactory.h>
+#include <GLRenderElementFactory.h>
+#include <GLShaderResFactory.h>
+#include <TextureRes.h>
+#include <FontRes.h>
+#include <FontResFactory.h>
+#include <GlyphSheetRes.h>
+#include <GlyphSheetResFactory.h>
+#include <Sdl2RgbaBitmapResFactory.h>
+#include <Sdl2RgbaBitmapRes.h>
+#include <ResRepositoryManager.h>
+#include <DefaultResFactory.h>
+#include <TextResFactory.h>
+
+#include "Trace.h"
+
+using namespace flappy;
+
+std::vector<SafePtr<ManagerBase>> createResourceManagers(Entity& entity, const std::string& resourcesPath) {
+    TRACE_SPAN("createResourceManagers", "resources");
+    return {
+        entity.createComponent<ResRepositoryManager>(resourcesPath),
+        entity.createComponent<TextResFactory>(),
+        entity.createComponent<ResManager<JsonRes>> (),
+        entity.createComponent<DefaultResFactory<JsonRes, JsonRes, TextRes>>(),
+        entity.createComponent<GLTextureResFactory>(),
+        entity.createComponent<Sdl2RgbaBitmapResFactory> (),
+        entity.createComponent<GLShaderResFactory> (),
+        entity.createComponent<ResManager<ShaderRes>> (),
+        entity.createComponent<ResManager<IRgbaBitmapRes>> (),
+        entity.createComponent<ResManager<TextureRes>> (),
+        entity.createComponent<ResManager<TextRes>> (),
+        entity.createComponent<ResManager<GlyphSheetRes>> (),
+        entity.createComponent<GlyphSheetResFactory>(),
+        entity.createComponent<ResManager<FontRes>> (),
+        entity.createComponent<FontResFactory>(),
+        entity.createComponent<GLRenderElementFactory>()
+    };
+}
+
+static uint64_t contentHash(const std::string& content) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char byte : content) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static int64_t nanoseconds(const struct timespec& time) {
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+static int64_t modificationTime(const struct stat& fileStat) {
+#ifdef __APPLE__
+    return nanoseconds(fileStat.st_mtimespec);
+#else
+    return nanoseconds(fileStat.st_mtim);
+#endif
+}
+
+static bool readFile(const std::string& path, std::string& content) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+static void makeDirectories(const std::string& path) {
+    for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1))
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    mkdir(path.c_str(), 0755);
+}
+
+/// Writes all of content, retrying short and interrupted writes
+static bool writeAll(int fd, const std::string& content) {
+    size_t written = 0;
+    while (written < content.size()) {
+        auto result = write(fd, content.data() + written, content.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+bool writeFileAtomically(const std::string& path, const std::string& content) {
+    auto slashPos = path.find_last_of('/');
+    if (slashPos != std::string::npos)
+        makeDirectories(path.substr(0, slashPos));
+    auto tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    // The data must be on disk before the rename makes it visible, or a
+    // crash can leave an empty file in place of the previous one
+    bool written = writeAll(fd, content) && fsync(fd) == 0;
+    written = close(fd) == 0 && written;
+    if (!written || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+ResourceCache::ResourceCache(const std::string& packedPath, const std::string& cachePath)
+    : m_packedPath(packedPath)
+    , m_cachePath(cachePath)
+    , m_entity(std::make_shared<Entity>())
+{
+    makeDirectories(m_cachePath);
+    m_managers = createResourceManagers(*m_entity, m_cachePath);
+    // Resource managers reload and release assets on these only
+    m_eventRoutes.consume<UpdateEvent>();
+    m_eventRoutes.consume<DeinitEvent>();
+    m_eventRoutes.consume<ManagerAddedEvent>();
+    m_eventRoutes.consume<ManagerRemovedEvent>();
+}
+
+void ResourceCache::scan(const std::string& relativePath, std::unordered_map<std::string, FileState>& files) {
+    auto directoryPath = relativePath.empty() ? m_packedPath : m_packedPath + "/" + relativePath;
+    auto dir = opendir(directoryPath.c_str());
+    if (dir == nullptr)
+        return;
+    while (auto entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        auto entryPath = relativePath.empty() ? name : relativePath + "/" + name;
+        struct stat entryStat;
+        if (stat((m_packedPath + "/" + entryPath).c_str(), &entryStat) != 0)
+            continue;
+        if (S_ISDIR(entryStat.st_mode))
+            scan(entryPath, files);
+        else if (S_ISREG(entryStat.st_mode))
+            files[entryPath] = {static_cast<int64_t>(entryStat.st_size), modificationTime(entryStat), 0};
+    }
+    closedir(dir);
+}
+
+std::vector<std::string> ResourceCache::sync() {
+    TRACE_SPAN("ResourceCache::sync", "resources");
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    auto previousSyncTime = m_syncTime;
+    m_syncTime = nanoseconds(now);
+    std::unordered_map<std::string, FileState> files;
+    scan("", files);
+
+    std::vector<std::string> changedPaths;
+    for (auto& filePair : files) {
+        const auto& relativePath = filePair.first;
+        auto& state = filePair.second;
+        auto oldIter = m_files.find(relativePath);
+        // A file modified just before the previous sync may have been
+        // rewritten since within the timestamp resolution of the file
+        // system, its content is compared then
+        if (oldIter != m_files.end()
+                && oldIter->second.size == state.size
+                && oldIter->second.modificationTime == state.modificationTime
+                && state.modificationTime + 1000000000 < previousSyncTime) {
+            state.hash = oldIter->second.hash;
+            continue;
+        }
+
+        std::string content;
+        if (!readFile(m_packedPath + "/" + relativePath, content))
+            continue;
+        state.hash = contentHash(content);
+        // Rewritten with the same content
+        if (oldIter != m_files.end() && oldIter->second.hash == state.hash)
+            continue;
+        // Left in the mirror by a previous session
+        std::string cachedContent;
+        if (oldIter == m_files.end()
+                && readFile(m_cachePath + "/" + relativePath, cachedContent)
+                && contentHash(cachedContent) == state.hash)
+            continue;
+
+        if (writeFileAtomically(m_cachePath + "/" + relativePath, content))
+            changedPaths.push_back(relativePath);
+        else
+            LOGE("Can't cache resource %s", relativePath.c_str());
+    }
+    for (const auto& filePair : m_files) {
+        if (files.find(filePair.first) == files.end()) {
+            unlink((m_cachePath + "/" + filePair.first).c_str());
+            changedPaths.push_back(filePair.first);
+        }
+    }
+    m_files.swap(files);
+    return changedPaths;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Entity.h>
+
+#include "EventRoutes.h"
+
+/// Creates the resource repository, resource managers and factories a
+/// project scene needs, reading packed resources from resourcesPath.
+std::vector<flappy::SafePtr<flappy::ManagerBase>> createResourceManagers(flappy::Entity& entity, const std::string& resourcesPath);
+
+/// Writes to a temporary file next to path and renames it over path, so
+/// readers never see a partially written file. Creates missing directories.
+bool writeFileAtomically(const std::string& path, const std::string& content);
+
+/// Resource managers that outlive project scenes. Loaded textures, shaders,
+/// glyph sheets and fonts are lent to every new scene instead of being
+/// loaded again.
+///
+/// The managers read from a mirror of the packed resources directory. sync()
+/// copies only files whose content hash changed, so a pack_res run that
+/// rewrites every file only makes the managers reload assets which really
+/// changed.
+class ResourceCache {
+public:
+    ResourceCache(const std::string& packedPath, const std::string& cachePath);
+
+    /// Updates the mirror, returns relative paths of changed or removed files
+    std::vector<std::string> sync();
+
+    std::shared_ptr<flappy::Entity> entity() { return m_entity; }
+    const std::vector<flappy::SafePtr<flappy::ManagerBase>>& managers() const { return m_managers; }
+
+    /// Event types forwarded into entity(), the ones resource managers consume
+    EventRoutes& eventRoutes() { return m_eventRoutes; }
+
+private:
+    struct FileState {
+        int64_t size;
+        /// Nanoseconds since the epoch
+        int64_t modificationTime;
+        uint64_t hash;
+    };
+
+    std::string m_packedPath;
+    std::string m_cachePath;
+    std::unordered_map<std::string, FileState> m_files;
+    /// Start of the previous sync(), nanoseconds since the epoch
+    int64_t m_syncTime = 0;
+    std::shared_ptr<flappy::Entity> m_entity;
+    std::vector<flappy::SafePtr<flappy::ManagerBase>> m_managers;
+    EventRoutes m_eventRoutes;
+
+    void scan(const std::string& relativePath, std::unordered_map<std::string, FileState>& files);
+};
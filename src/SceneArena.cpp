@@ -0,0 +1,87 @@
+#include "SceneArena.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace flappy;
+
+static thread_local std::shared_ptr<SceneArena> currentArena;
+
+SceneArena::SceneArena(size_t blockSize)
+    : m_blockSize(blockSize > maxPooledSize ? blockSize : maxPooledSize)
+    , m_freeLists(maxPooledSize / granularity + 1, nullptr)
+{}
+
+SceneArena::~SceneArena() {
+    for (auto block : m_blocks)
+        std::free(block);
+}
+
+void* SceneArena::allocate(size_t size, size_t alignment) {
+    if (!pooled(size, alignment))
+        return ::operator new(size);
+    auto sizeClass = (size + granularity - 1) / granularity;
+    auto roundedSize = sizeClass * granularity;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allocationCount++;
+    m_liveBytes += roundedSize;
+    auto& freeList = m_freeLists[sizeClass];
+    if (freeList != nullptr) {
+        auto pointer = freeList;
+        freeList = *static_cast<void**>(pointer);
+        return pointer;
+    }
+    if (m_cursor == nullptr || static_cast<size_t>(m_end - m_cursor) < roundedSize) {
+        // The tail of the previous block is left unused
+        auto block = static_cast<char*>(std::malloc(m_blockSize));
+        if (block == nullptr)
+            throw std::bad_alloc();
+        m_blocks.push_back(block);
+        m_cursor = block;
+        m_end = block + m_blockSize;
+    }
+    auto pointer = m_cursor;
+    m_cursor += roundedSize;
+    return pointer;
+}
+
+void SceneArena::deallocate(void* pointer, size_t size, size_t alignment) {
+    if (!pooled(size, alignment)) {
+        ::operator delete(pointer);
+        return;
+    }
+    auto sizeClass = (size + granularity - 1) / granularity;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_liveBytes -= sizeClass * granularity;
+    auto& freeList = m_freeLists[sizeClass];
+    *static_cast<void**>(pointer) = freeList;
+    freeList = pointer;
+}
+
+SceneArena::Stats SceneArena::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_blocks.size(), m_allocationCount, m_liveBytes};
+}
+
+const std::shared_ptr<SceneArena>& SceneArena::current() {
+    return currentArena;
+}
+
+SceneArena::Scope::Scope(std::shared_ptr<SceneArena> arena)
+    : m_previous(std::move(currentArena))
+{
+    currentArena = std::move(arena);
+}
+
+SceneArena::Scope::~Scope() {
+    currentArena = std::move(m_previous);
+}
+
+std::shared_ptr<Entity> makeSceneEntity() {
+    const auto& arena = SceneArena::current();
+    if (arena == nullptr)
+        return std::make_shared<Entity>();
+    return std::allocate_shared<Entity>(SceneArenaAllocator<Entity>(arena));
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Entity.h>
+
+/// Memory for the entities of a scene. Small allocations are carved from
+/// large blocks and recycled by size, so loading a scene makes a few block
+/// allocations instead of one per entity. Every allocation keeps the arena
+/// alive, its blocks are released together once the last entity is gone.
+///
+/// Thread safe, entities of a scene may be created on several workers.
+class SceneArena {
+public:
+    struct Stats {
+        size_t blockCount;
+        /// Allocations served from blocks, including recycled ones
+        size_t allocationCount;
+        size_t liveBytes;
+    };
+
+    explicit SceneArena(size_t blockSize = 64 * 1024);
+    SceneArena(const SceneArena&) = delete;
+    SceneArena& operator=(const SceneArena&) = delete;
+    ~SceneArena();
+
+    void* allocate(size_t size, size_t alignment);
+    void deallocate(void* pointer, size_t size, size_t alignment);
+
+    Stats stats() const;
+
+    /// Arena SceneLoader creates entities in on the calling thread, null
+    /// means the global heap
+    static const std::shared_ptr<SceneArena>& current();
+
+    /// Makes an arena current on this thread for the scope
+    class Scope {
+    public:
+        explicit Scope(std::shared_ptr<SceneArena> arena);
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope();
+
+    private:
+        std::shared_ptr<SceneArena> m_previous;
+    };
+
+private:
+    static constexpr size_t granularity = alignof(std::max_align_t);
+    /// Larger allocations go to the global heap
+    static constexpr size_t maxPooledSize = 1024;
+
+    size_t m_blockSize;
+    mutable std::mutex m_mutex;
+    std::vector<char*> m_blocks;
+    char* m_cursor = nullptr;
+    char* m_end = nullptr;
+    /// Intrusive lists of released allocations by size class
+    std::vector<void*> m_freeLists;
+    size_t m_allocationCount = 0;
+    size_t m_liveBytes = 0;
+
+    static bool pooled(size_t size, size_t alignment) {
+        return size <= maxPooledSize && alignment <= granularity;
+    }
+};
+
+/// Standard allocator drawing from a SceneArena, holds the arena alive
+template <typename T>
+class SceneArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit SceneArenaAllocator(std::shared_ptr<SceneArena> arena)
+        : m_arena(std::move(arena))
+    {}
+
+    template <typename U>
+    SceneArenaAllocator(const SceneArenaAllocator<U>& other)
+        : m_arena(other.arena())
+    {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t n) {
+        m_arena->deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    const std::shared_ptr<SceneArena>& arena() const { return m_arena; }
+
+    template <typename U>
+    bool operator==(const SceneArenaAllocator<U>& other) const { return m_arena == other.arena(); }
+    template <typename U>
+    bool operator!=(const SceneArenaAllocator<U>& other) const { return m_arena != other.arena(); }
+
+private:
+    std::shared_ptr<SceneArena> m_arena;
+};
+
+/// Entity in the current arena of the thread, or on the heap without one
+std::shared_ptr<flappy::Entity> makeSceneEntity();
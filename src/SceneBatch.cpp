@@ -0,0 +1,217 @@
+#include "SceneBatch.h"
+
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <Entity.h>
+
+#include "BinaryScene.h"
+#include "FileWatcher.h"
+#include "Prefab.h"
+#include "Property.h"
+#include "ResourceCache.h"
+#include "ThreadPool.h"
+
+using namespace flappy;
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+static double milliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+json SceneBatch::SceneReport::toJson() const {
+    json jsonReport = {
+        {"scene", scenePath},
+        {"valid", error.empty() && problems.empty()},
+        {"entities", entityCount},
+        {"components", componentCount},
+        {"parseMs", milliseconds(parseTime)},
+        {"validateMs", milliseconds(validateTime)},
+        {"writeMs", milliseconds(writeTime)},
+        {"problems", problems}
+    };
+    if (!error.empty())
+        jsonReport["error"] = error;
+    if (!outputPath.empty())
+        jsonReport["output"] = outputPath;
+    return jsonReport;
+}
+
+SceneBatch::SceneBatch(const std::string& projectPath, const Options& options)
+    : m_projectPath(projectPath)
+    , m_options(options)
+{}
+
+int SceneBatch::run() {
+    auto startTime = Clock::now();
+    if (m_options.output != Output::None) {
+        // Parallel conversions must not write the same file
+        std::unordered_map<std::string, std::string> scenesByOutput;
+        for (const auto& scenePath : m_options.scenePaths) {
+            auto insertResult = scenesByOutput.emplace(outputPath(scenePath), scenePath);
+            if (!insertResult.second) {
+                LOGE("%s and %s are both converted to %s", insertResult.first->second.c_str(),
+                     scenePath.c_str(), insertResult.first->first.c_str());
+                return 2;
+            }
+        }
+    }
+    try {
+        RTTRService::instance().loadLibrary(libraryPath());
+    } catch (const std::exception& e) {
+        LOGE("Can't load library. %s", e.what());
+        return 2;
+    }
+    PrefabRegistry::instance().setBasePath(m_projectPath);
+
+    auto& threadPool = ThreadPool::shared();
+    std::vector<std::future<SceneReport>> futures;
+    futures.reserve(m_options.scenePaths.size());
+    for (const auto& scenePath : m_options.scenePaths)
+        futures.push_back(threadPool.submit([this, scenePath]() { return processScene(scenePath); }));
+
+    json jsonScenes = json::array();
+    size_t failedCount = 0;
+    for (auto& future : futures) {
+        auto report = future.get();
+        if (!report.error.empty() || !report.problems.empty()) {
+            failedCount++;
+            LOGE("%s: %s", report.scenePath.c_str(), report.error.empty() ? "invalid" : report.error.c_str());
+            for (const auto& problem : report.problems)
+                LOGE("    %s", problem.c_str());
+        }
+        jsonScenes.push_back(report.toJson());
+    }
+
+    json jsonReport = {
+        {"threads", threadPool.size()},
+        {"sceneCount", m_options.scenePaths.size()},
+        {"failedCount", failedCount},
+        {"totalMs", milliseconds(Clock::now() - startTime)},
+        {"scenes", std::move(jsonScenes)}
+    };
+    std::ofstream reportStream(m_options.reportPath);
+    reportStream << jsonReport.dump(4) << std::endl;
+    if (!reportStream) {
+        LOGE("Can't write report to %s", m_options.reportPath.c_str());
+        return 2;
+    }
+    LOGI("%zu of %zu scenes are valid, report is written to %s",
+         m_options.scenePaths.size() - failedCount, m_options.scenePaths.size(), m_options.reportPath.c_str());
+    return failedCount == 0 ? 0 : 1;
+}
+
+SceneBatch::SceneReport SceneBatch::processScene(const std::string& scenePath) const {
+    SceneReport report;
+    report.scenePath = scenePath;
+    try {
+        auto fullPath = !scenePath.empty() && scenePath[0] == '/' ? scenePath : m_projectPath + "/" + scenePath;
+
+        auto parseStart = Clock::now();
+        std::ifstream stream(fullPath);
+        if (!stream)
+            throw std::runtime_error("Can't open " + fullPath);
+        std::stringstream text;
+        text << stream.rdbuf();
+        auto tree = json::parse(text.str());
+        auto validateStart = Clock::now();
+        report.parseTime = validateStart - parseStart;
+
+        validateEntity(tree, "", report);
+        auto writeStart = Clock::now();
+        report.validateTime = writeStart - validateStart;
+
+        if (m_options.output == Output::None || !report.problems.empty())
+            return report;
+        report.outputPath = outputPath(scenePath);
+        auto content = m_options.output == Output::Binary ? BinaryScene::fromJson(tree) : tree.dump(4) + "\n";
+        if (!writeFileAtomically(report.outputPath, content))
+            throw std::runtime_error("Can't write " + report.outputPath);
+        report.writeTime = Clock::now() - writeStart;
+    } catch (const std::exception& e) {
+        report.error = e.what();
+    }
+    return report;
+}
+
+void SceneBatch::validateEntity(const json& jsonEntity, const std::string& location, SceneReport& report) const {
+    report.entityCount++;
+    if (Prefab::isInstance(jsonEntity)) {
+        // Overrides are checked as part of the expanded template
+        try {
+            validateEntity(PrefabRegistry::instance().expand(jsonEntity), location + "/prefab", report);
+        } catch (const std::exception& e) {
+            report.problems.push_back((location.empty() ? "/" : location) + ": " + e.what());
+        }
+        return;
+    }
+
+    auto componentsIter = jsonEntity.find("components");
+    if (componentsIter != jsonEntity.end() && componentsIter->is_array()) {
+        for (size_t i = 0; i < componentsIter->size(); i++) {
+            const auto& jsonComponent = (*componentsIter)[i];
+            auto componentLocation = location + "/components/" + std::to_string(i);
+            report.componentCount++;
+            auto typeName = jsonComponent.value("type", std::string());
+            std::shared_ptr<ComponentBase> component;
+            try {
+                component = RTTRService::instance().createComponent(TypeId<ComponentBase>(typeName));
+            } catch (const std::exception& e) {
+                LOGE("Can't create component. %s", e.what());
+            }
+            if (component == nullptr) {
+                report.problems.push_back(componentLocation + ": unknown type '" + typeName + "'");
+                continue;
+            }
+            // Values are set to a detached component, which is never initialized
+            auto componentPointer = RTTRService::instance().toVariant(component);
+            auto properties = PropertyRegistry::instance().propertyList(componentPointer.get_type());
+            for (auto fieldIter = jsonComponent.begin(); fieldIter != jsonComponent.end(); fieldIter++) {
+                if (fieldIter.key() == "type")
+                    continue;
+                auto index = properties->indexOf(fieldIter.key());
+                if (index == PropertyList::npos) {
+                    report.problems.push_back(componentLocation + ": unknown property '" + fieldIter.key() + "' of " + typeName);
+                    continue;
+                }
+                try {
+                    (*properties)[index].setValue(componentPointer, fieldIter.value());
+                } catch (const std::exception& e) {
+                    report.problems.push_back(componentLocation + ": bad value of '" + fieldIter.key() + "'. " + e.what());
+                }
+            }
+        }
+    }
+
+    auto entitiesIter = jsonEntity.find("entities");
+    if (entitiesIter != jsonEntity.end() && entitiesIter->is_array()) {
+        for (size_t i = 0; i < entitiesIter->size(); i++)
+            validateEntity((*entitiesIter)[i], location + "/entities/" + std::to_string(i), report);
+    }
+}
+
+std::string SceneBatch::outputPath(const std::string& scenePath) const {
+    // Normalized paths are relative or start with the only slash
+    auto relativePath = FileWatcher::normalizePath(scenePath);
+    if (!relativePath.empty() && relativePath[0] == '/')
+        relativePath.erase(0, 1);
+    auto slashPos = relativePath.find_last_of('/');
+    auto dotPos = relativePath.find_last_of('.');
+    if (dotPos != std::string::npos && (slashPos == std::string::npos || dotPos > slashPos))
+        relativePath.resize(dotPos);
+    return m_options.outputDirectory + "/" + relativePath + (m_options.output == Output::Binary ? ".bscene" : ".scene");
+}
+
+std::string SceneBatch::libraryPath() const {
+    if (!m_options.libraryPath.empty())
+        return m_options.libraryPath;
+#ifdef __APPLE__
+    return m_projectPath + "/generated/cmake/build/libTestProject.dylib";
+#else
+    return m_projectPath + "/generated/cmake/build/libTestProject.so";
+#endif
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <json/json.hpp>
+
+/// Headless processing of scene files, no window or GL context is created.
+/// Loads the project library, then validates scenes in parallel on the
+/// thread pool against the registered types: unknown component types,
+/// unknown properties and values a property doesn't accept are reported.
+/// Valid scenes may be re-saved as canonical json or in the binary format.
+class SceneBatch {
+public:
+    enum class Output {
+        None,
+        /// Sorted keys and four space indentation
+        Canonical,
+        /// See BinaryScene.h
+        Binary
+    };
+
+    struct Options {
+        std::string reportPath = "batch_report.json";
+        Output output = Output::None;
+        /// Converted scenes are written here under their paths relative to
+        /// the project, absolute scene paths are nested under it as a whole
+        std::string outputDirectory = ".";
+        /// Project library, the one built by flappy if empty
+        std::string libraryPath;
+        /// Relative paths are relative to the project
+        std::vector<std::string> scenePaths;
+    };
+
+    SceneBatch(const std::string& projectPath, const Options& options);
+
+    /// Returns the process exit code, non-zero if a scene failed
+    int run();
+
+private:
+    struct SceneReport {
+        std::string scenePath;
+        std::string outputPath;
+        /// Failure to read, parse or write the scene
+        std::string error;
+        std::vector<std::string> problems;
+        size_t entityCount = 0;
+        size_t componentCount = 0;
+        std::chrono::nanoseconds parseTime {0};
+        std::chrono::nanoseconds validateTime {0};
+        std::chrono::nanoseconds writeTime {0};
+
+        nlohmann::json toJson() const;
+    };
+
+    std::string m_projectPath;
+    Options m_options;
+
+    SceneReport processScene(const std::string& scenePath) const;
+    void validateEntity(const nlohmann::json& jsonEntity, const std::string& location, SceneReport& report) const;
+    std::string outputPath(const std::string& scenePath) const;
+    std::string libraryPath() const;
+};
@@ -0,0 +1,117 @@
+#include "SceneCache.h"
+
+using json = nlohmann::json;
+
+SceneCache::SceneCache(size_t maxScenes, size_t maxBytes, size_t maxLiveScenes)
+    : m_maxScenes(maxScenes)
+    , m_maxBytes(maxBytes)
+    , m_maxLiveScenes(maxLiveScenes)
+{}
+
+void SceneCache::setLimits(size_t maxScenes, size_t maxBytes, size_t maxLiveScenes) {
+    m_maxScenes = maxScenes;
+    m_maxBytes = maxBytes;
+    m_maxLiveScenes = maxLiveScenes;
+    evict();
+}
+
+size_t SceneCache::approximateSize(const json& tree) {
+    // Node sizes of the json library plus heap blocks of containers and strings
+    size_t size = sizeof(json);
+    switch (tree.type()) {
+    case json::value_t::object:
+        for (auto iter = tree.begin(); iter != tree.end(); iter++)
+            size += 64 + iter.key().size() + approximateSize(iter.value());
+        break;
+    case json::value_t::array:
+        for (const auto& item : tree)
+            size += approximateSize(item);
+        break;
+    case json::value_t::string:
+        size += 32 + tree.get_ref<const std::string&>().size();
+        break;
+    default:
+        break;
+    }
+    return size;
+}
+
+void SceneCache::put(const std::string& scenePath, Entry entry) {
+    erase(scenePath);
+    auto byteSize = approximateSize(entry.tree);
+    m_entries.push_front({scenePath, std::move(entry), byteSize});
+    m_index[scenePath] = m_entries.begin();
+    m_byteSize += byteSize;
+    evict();
+}
+
+bool SceneCache::take(const std::string& scenePath, Entry& entry) {
+    auto indexIter = m_index.find(scenePath);
+    if (indexIter == m_index.end())
+        return false;
+    entry = std::move(indexIter->second->entry);
+    m_byteSize -= indexIter->second->byteSize;
+    m_entries.erase(indexIter->second);
+    m_index.erase(indexIter);
+    return true;
+}
+
+void SceneCache::erase(const std::string& scenePath) {
+    auto indexIter = m_index.find(scenePath);
+    if (indexIter == m_index.end())
+        return;
+    m_byteSize -= indexIter->second->byteSize;
+    m_entries.erase(indexIter->second);
+    m_index.erase(indexIter);
+}
+
+void SceneCache::dropLiveScene(Item& item) {
+    item.entry.projectRoutes.reset();
+    item.entry.projectRoot.reset();
+    item.entry.editHistory.reset(SceneDocument());
+}
+
+void SceneCache::dropLiveScenes() {
+    for (auto& item : m_entries)
+        dropLiveScene(item);
+    evict();
+}
+
+void SceneCache::clear() {
+    m_entries.clear();
+    m_index.clear();
+    m_byteSize = 0;
+}
+
+std::vector<std::string> SceneCache::scenePaths() const {
+    std::vector<std::string> scenePaths;
+    scenePaths.reserve(m_entries.size());
+    for (const auto& item : m_entries)
+        scenePaths.push_back(item.scenePath);
+    return scenePaths;
+}
+
+void SceneCache::evict() {
+    size_t liveScenes = 0;
+    for (auto& item : m_entries) {
+        if (item.entry.projectRoot == nullptr)
+            continue;
+        if (++liveScenes > m_maxLiveScenes)
+            dropLiveScene(item);
+    }
+    // An entry left with neither a parsed scene nor a tree is useless
+    for (auto iter = m_entries.begin(); iter != m_entries.end();) {
+        if (iter->entry.tree.is_null() && iter->entry.projectRoot == nullptr) {
+            m_byteSize -= iter->byteSize;
+            m_index.erase(iter->scenePath);
+            iter = m_entries.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+    while (!m_entries.empty() && (m_entries.size() > m_maxScenes || m_byteSize > m_maxBytes)) {
+        m_byteSize -= m_entries.back().byteSize;
+        m_index.erase(m_entries.back().scenePath);
+        m_entries.pop_back();
+    }
+}
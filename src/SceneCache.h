@@ -0,0 +1,74 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.hpp>
+
+#include <Entity.h>
+
+#include "EditHistory.h"
+#include "EventRoutes.h"
+
+/// Recently selected scenes, so switching back to a scene skips reading,
+/// parsing and instantiating it. An entry keeps the parsed scene and may
+/// keep the instantiated tree too. A cached tree is dormant, the editor
+/// forwards events only to the selected scene.
+///
+/// Entries are evicted least recently used first, by count and by the
+/// approximate size of parsed scenes. Instantiated trees are limited
+/// separately, an entry over that limit falls back to its parsed scene.
+class SceneCache {
+public:
+    struct Entry {
+        /// Null if the scene was streamed
+        nlohmann::json tree;
+        /// Null if only the parsed scene is kept
+        std::shared_ptr<flappy::Entity> projectRoot;
+        std::shared_ptr<EventRoutes> projectRoutes;
+        /// History of the instantiated tree
+        EditHistory editHistory;
+    };
+
+    SceneCache(size_t maxScenes = 8, size_t maxBytes = 256 * 1024 * 1024, size_t maxLiveScenes = 3);
+
+    void setLimits(size_t maxScenes, size_t maxBytes, size_t maxLiveScenes);
+
+    /// Replaces the entry of the scene, it becomes the most recently used one
+    void put(const std::string& scenePath, Entry entry);
+    /// Removes the entry and returns it, false if the scene isn't cached
+    bool take(const std::string& scenePath, Entry& entry);
+    void erase(const std::string& scenePath);
+    /// Instantiated trees are made of the project library, they must be
+    /// dropped before it's unloaded
+    void dropLiveScenes();
+    void clear();
+
+    std::vector<std::string> scenePaths() const;
+    size_t size() const { return m_entries.size(); }
+    size_t byteSize() const { return m_byteSize; }
+
+    /// Rough memory footprint of a parsed scene
+    static size_t approximateSize(const nlohmann::json& tree);
+
+private:
+    struct Item {
+        std::string scenePath;
+        Entry entry;
+        size_t byteSize;
+    };
+
+    size_t m_maxScenes;
+    size_t m_maxBytes;
+    size_t m_maxLiveScenes;
+    /// Most recently used first
+    std::list<Item> m_entries;
+    std::unordered_map<std::string, std::list<Item>::iterator> m_index;
+    size_t m_byteSize = 0;
+
+    void dropLiveScene(Item& item);
+    void evict();
+};
@@ -0,0 +1,201 @@
+#include "SceneDocument.h"
+
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Prefab.h"
+
+using json = nlohmann::json;
+
+static std::shared_ptr<const SceneDocument::Node> modifiedNode(const SceneDocument::Node& node,
+                                                               const ScenePath& path,
+                                                               size_t depth,
+                                                               const std::function<void(SceneDocument::Node&)>& modify) {
+    // Shallow copy, children and components stay shared
+    auto copy = std::make_shared<SceneDocument::Node>(node);
+    if (depth == path.size()) {
+        modify(*copy);
+    } else {
+        auto& child = copy->children.at(path[depth]);
+        child = modifiedNode(*child, path, depth + 1, modify);
+    }
+    return copy;
+}
+
+static std::shared_ptr<const SceneDocument::Node> nodeFromJson(const json& jsonEntity);
+
+/// Nodes of a template are shared by all its instances, an override copies
+/// only the path to the overridden component
+static std::shared_ptr<const SceneDocument::Node> instanceNode(const json& jsonEntity) {
+    using TemplateNodes = std::unordered_map<const json*, std::pair<std::weak_ptr<const json>, std::shared_ptr<const SceneDocument::Node>>>;
+    static std::mutex templateNodesMutex;
+    static TemplateNodes templateNodes;
+
+    auto prefabTemplate = PrefabRegistry::instance().prefabTemplate(Prefab::path(jsonEntity));
+    std::shared_ptr<const SceneDocument::Node> node;
+    {
+        std::lock_guard<std::mutex> lock(templateNodesMutex);
+        auto nodeIter = templateNodes.find(prefabTemplate.get());
+        if (nodeIter != templateNodes.end() && nodeIter->second.first.lock() == prefabTemplate) {
+            node = nodeIter->second.second;
+        } else {
+            // Templates are expanded, building the node doesn't come back here
+            node = nodeFromJson(*prefabTemplate);
+            for (auto iter = templateNodes.begin(); iter != templateNodes.end();)
+                iter = iter->second.first.expired() ? templateNodes.erase(iter) : std::next(iter);
+            templateNodes[prefabTemplate.get()] = std::make_pair(prefabTemplate, node);
+        }
+    }
+
+    for (const auto& jsonOverride : Prefab::overrides(jsonEntity)) {
+        ScenePath path;
+        auto pathIter = jsonOverride.find("entity");
+        if (pathIter != jsonOverride.end()) {
+            for (const auto& index : *pathIter)
+                path.push_back(index.get<size_t>());
+        }
+        auto componentIndex = jsonOverride.value("component", size_t(0));
+        const auto& values = jsonOverride.at("values");
+        node = modifiedNode(*node, path, 0, [componentIndex, &values](SceneDocument::Node& overriddenNode) {
+            auto& component = overriddenNode.components.at(componentIndex);
+            auto jsonComponent = std::make_shared<json>(*component);
+            for (auto valueIter = values.begin(); valueIter != values.end(); valueIter++)
+                (*jsonComponent)[valueIter.key()] = valueIter.value();
+            component = std::move(jsonComponent);
+        });
+    }
+    // Shallow copy, the subtree stays shared with the template
+    auto instance = std::make_shared<SceneDocument::Node>(*node);
+    instance->prefabPath = Prefab::path(jsonEntity);
+    instance->overrides = Prefab::overrides(jsonEntity);
+    return instance;
+}
+
+static std::shared_ptr<const SceneDocument::Node> nodeFromJson(const json& jsonEntity) {
+    if (Prefab::isInstance(jsonEntity))
+        return instanceNode(jsonEntity);
+    auto node = std::make_shared<SceneDocument::Node>();
+    auto componentsIter = jsonEntity.find("components");
+    if (componentsIter != jsonEntity.end() && componentsIter->is_array()) {
+        node->components.reserve(componentsIter->size());
+        for (const auto& jsonComponent : *componentsIter)
+            node->components.push_back(std::make_shared<const json>(jsonComponent));
+    }
+    auto entitiesIter = jsonEntity.find("entities");
+    if (entitiesIter != jsonEntity.end() && entitiesIter->is_array()) {
+        node->children.reserve(entitiesIter->size());
+        for (const auto& jsonChild : *entitiesIter)
+            node->children.push_back(nodeFromJson(jsonChild));
+    }
+    return node;
+}
+
+static json expandedNodeToJson(const SceneDocument::Node& node);
+
+/// An instance is written with its overrides as read while its values match
+/// them, otherwise with overrides collected against the template. An
+/// instance whose structure was edited can only be written expanded.
+static json nodeToJson(const SceneDocument::Node& node) {
+    if (node.prefabPath.empty())
+        return expandedNodeToJson(node);
+    json jsonInstance = { { "prefab", node.prefabPath } };
+    if (!node.overrides.empty())
+        jsonInstance["overrides"] = node.overrides;
+    auto expanded = expandedNodeToJson(node);
+    try {
+        if (PrefabRegistry::instance().expand(jsonInstance) == expanded)
+            return jsonInstance;
+        auto prefabTemplate = PrefabRegistry::instance().prefabTemplate(node.prefabPath);
+        return Prefab::compact(node.prefabPath, *prefabTemplate, expanded);
+    } catch (const std::exception&) {
+        // The template can't be read any more, the values are kept at least
+        return expanded;
+    }
+}
+
+static json expandedNodeToJson(const SceneDocument::Node& node) {
+    json jsonEntity = json::object();
+    if (!node.components.empty()) {
+        auto& jsonComponents = jsonEntity["components"] = json::array();
+        for (const auto& component : node.components)
+            jsonComponents.push_back(*component);
+    }
+    if (!node.children.empty()) {
+        auto& jsonEntities = jsonEntity["entities"] = json::array();
+        for (const auto& child : node.children)
+            jsonEntities.push_back(nodeToJson(*child));
+    }
+    return jsonEntity;
+}
+
+template <typename VectorT>
+static void checkIndex(const VectorT& vector, size_t index, bool inserting) {
+    if (inserting ? index > vector.size() : index >= vector.size())
+        throw std::out_of_range("Scene document index is out of range");
+}
+
+SceneDocument::SceneDocument()
+    : m_root(std::make_shared<const Node>())
+{}
+
+SceneDocument::SceneDocument(std::shared_ptr<const Node> root)
+    : m_root(std::move(root))
+{}
+
+SceneDocument SceneDocument::fromJson(const json& jsonEntity) {
+    return SceneDocument(nodeFromJson(jsonEntity));
+}
+
+json SceneDocument::toJson(const ScenePath& path) const {
+    return nodeToJson(node(path));
+}
+
+const SceneDocument::Node& SceneDocument::node(const ScenePath& path) const {
+    const Node* node = m_root.get();
+    for (auto index : path)
+        node = node->children.at(index).get();
+    return *node;
+}
+
+SceneDocument SceneDocument::modified(const ScenePath& path, const std::function<void(Node&)>& modify) const {
+    return SceneDocument(modifiedNode(*m_root, path, 0, modify));
+}
+
+SceneDocument SceneDocument::withProperty(const ScenePath& path, size_t componentIndex, const std::string& name, const json& value) const {
+    return modified(path, [componentIndex, &name, &value](Node& node) {
+        auto& component = node.components.at(componentIndex);
+        auto jsonComponent = std::make_shared<json>(*component);
+        (*jsonComponent)[name] = value;
+        component = std::move(jsonComponent);
+    });
+}
+
+SceneDocument SceneDocument::withComponent(const ScenePath& path, size_t index, const json& jsonComponent) const {
+    return modified(path, [index, &jsonComponent](Node& node) {
+        checkIndex(node.components, index, true);
+        node.components.insert(node.components.begin() + index, std::make_shared<const json>(jsonComponent));
+    });
+}
+
+SceneDocument SceneDocument::withoutComponent(const ScenePath& path, size_t index) const {
+    return modified(path, [index](Node& node) {
+        checkIndex(node.components, index, false);
+        node.components.erase(node.components.begin() + index);
+    });
+}
+
+SceneDocument SceneDocument::withEntity(const ScenePath& parentPath, size_t index, const json& jsonEntity) const {
+    return modified(parentPath, [index, &jsonEntity](Node& node) {
+        checkIndex(node.children, index, true);
+        node.children.insert(node.children.begin() + index, nodeFromJson(jsonEntity));
+    });
+}
+
+SceneDocument SceneDocument::withoutEntity(const ScenePath& parentPath, size_t index) const {
+    return modified(parentPath, [index](Node& node) {
+        checkIndex(node.children, index, false);
+        node.children.erase(node.children.begin() + index);
+    });
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <json/json.hpp>
+
+#include "SceneNode.h"
+
+/// Immutable scene tree in the json scene format. An edit copies only the
+/// nodes on the path to the changed entity, everything else is shared with
+/// the previous version, so keeping many versions costs little memory and two
+/// versions are compared by skipping shared subtrees. Prefab instances are
+/// expanded, sharing the nodes of their template, and keep their reference,
+/// so toJson() writes them as instances again.
+class SceneDocument {
+public:
+    struct Node {
+        std::vector<std::shared_ptr<const nlohmann::json>> components;
+        std::vector<std::shared_ptr<const Node>> children;
+        /// Prefab of an instance, empty for other entities
+        std::string prefabPath;
+        /// Overrides the instance was read with
+        nlohmann::json overrides;
+    };
+
+    SceneDocument();
+
+    static SceneDocument fromJson(const nlohmann::json& jsonEntity);
+    /// The entity at path with its subtree
+    nlohmann::json toJson(const ScenePath& path = ScenePath()) const;
+
+    const std::shared_ptr<const Node>& root() const { return m_root; }
+    /// Throws std::out_of_range if the path doesn't exist
+    const Node& node(const ScenePath& path) const;
+
+    SceneDocument withProperty(const ScenePath& path, size_t componentIndex, const std::string& name, const nlohmann::json& value) const;
+    SceneDocument withComponent(const ScenePath& path, size_t index, const nlohmann::json& jsonComponent) const;
+    SceneDocument withoutComponent(const ScenePath& path, size_t index) const;
+    SceneDocument withEntity(const ScenePath& parentPath, size_t index, const nlohmann::json& jsonEntity) const;
+    SceneDocument withoutEntity(const ScenePath& parentPath, size_t index) const;
+
+private:
+    explicit SceneDocument(std::shared_ptr<const Node> root);
+
+    std::shared_ptr<const Node> m_root;
+
+    SceneDocument modified(const ScenePath& path, const std::function<void(Node&)>& modify) const;
+};
@@ -0,0 +1,306 @@
+#include "SceneIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "Trace.h"
+
+using namespace flappy;
+
+static float checkedCellSize(float cellSize) {
+    if (!std::isfinite(cellSize) || cellSize <= 0.0f)
+        throw std::invalid_argument("Cell size must be positive");
+    return cellSize;
+}
+
+SceneIndex::SceneIndex(float cellSize)
+    : m_cellSize(checkedCellSize(cellSize))
+{}
+
+void SceneIndex::setCellSize(float cellSize) {
+    checkedCellSize(cellSize);
+    if (m_cellSize == cellSize)
+        return;
+    m_cellSize = cellSize;
+    m_cells.clear();
+    for (auto& recordPair : m_records) {
+        if (recordPair.second.placed) {
+            recordPair.second.placed = false;
+            place(recordPair.first, recordPair.second);
+        }
+    }
+}
+
+static uint64_t packCell(int32_t cellX, int32_t cellY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellY);
+}
+
+/// Cell of a coordinate. Far and infinite ones are clamped to the edge
+/// cells, NaN falls into cell 0, the cast of either would be undefined.
+static int32_t cellCoordinate(float value, float cellSize) {
+    auto cell = std::floor(static_cast<double>(value) / cellSize);
+    if (std::isnan(cell))
+        return 0;
+    cell = std::max<double>(cell, std::numeric_limits<int32_t>::min());
+    cell = std::min<double>(cell, std::numeric_limits<int32_t>::max());
+    return static_cast<int32_t>(cell);
+}
+
+SceneIndex::CellKey SceneIndex::cellKey(float x, float y) const {
+    return packCell(cellCoordinate(x, m_cellSize), cellCoordinate(y, m_cellSize));
+}
+
+void SceneIndex::rebuild(const SceneNode& root) {
+    TRACE_SPAN("SceneIndex::rebuild", "scene");
+    clear();
+    addSubtree(root, nullptr);
+}
+
+void SceneIndex::clear() {
+    m_records.clear();
+    m_entitiesByType.clear();
+    m_cells.clear();
+}
+
+void SceneIndex::addEntity(const SceneNode& parent, const SceneNode& node) {
+    addSubtree(node, m_records.count(parent.entity.get()) != 0 ? parent.entity.get() : nullptr);
+}
+
+void SceneIndex::removeEntity(const SceneNode& node) {
+    auto recordIter = m_records.find(node.entity.get());
+    if (recordIter != m_records.end() && recordIter->second.parent != nullptr) {
+        auto& siblings = m_records.at(recordIter->second.parent).children;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), recordIter->first), siblings.end());
+    }
+    removeSubtree(node);
+}
+
+void SceneIndex::updateEntity(const SceneNode& node) {
+    auto recordIter = m_records.find(node.entity.get());
+    if (recordIter == m_records.end())
+        return;
+    unindexComponents(recordIter->first, recordIter->second);
+    indexComponents(recordIter->first, recordIter->second, node);
+    relocate(recordIter->first, recordIter->second);
+}
+
+void SceneIndex::updatePosition(const SceneNode& node) {
+    auto recordIter = m_records.find(node.entity.get());
+    if (recordIter != m_records.end())
+        relocate(recordIter->first, recordIter->second);
+}
+
+void SceneIndex::updatePositions() {
+    TRACE_SPAN("SceneIndex::updatePositions", "scene");
+    for (auto& recordPair : m_records) {
+        if (recordPair.second.parent == nullptr)
+            relocateAll(recordPair.first, recordPair.second);
+    }
+}
+
+void SceneIndex::addSubtree(const SceneNode& node, const Entity* parentKey) {
+    auto key = parentKey;
+    if (node.entity != nullptr) {
+        key = node.entity.get();
+        auto& record = m_records[key];
+        record.entity = node.entity;
+        record.parent = parentKey;
+        if (parentKey != nullptr)
+            m_records.at(parentKey).children.push_back(key);
+        indexComponents(key, record, node);
+        updateFrame(key, record);
+    }
+    for (const auto& child : node.children)
+        addSubtree(*child, key);
+}
+
+void SceneIndex::removeSubtree(const SceneNode& node) {
+    auto recordIter = m_records.find(node.entity.get());
+    if (recordIter != m_records.end()) {
+        unindexComponents(recordIter->first, recordIter->second);
+        unplace(recordIter->first, recordIter->second);
+        m_records.erase(recordIter);
+    }
+    for (const auto& child : node.children)
+        removeSubtree(*child);
+}
+
+SceneIndex::Frame SceneIndex::compose(const Frame& parent, const TransformComponent& transform) {
+    auto pos = transform.pos();
+    auto scale = transform.scale();
+    auto x = pos.x * parent.scaleX;
+    auto y = pos.y * parent.scaleY;
+    auto cosAngle = std::cos(parent.angle);
+    auto sinAngle = std::sin(parent.angle);
+    Frame frame;
+    frame.x = parent.x + x * cosAngle - y * sinAngle;
+    frame.y = parent.y + x * sinAngle + y * cosAngle;
+    frame.angle = parent.angle + transform.angle();
+    frame.scaleX = parent.scaleX * scale.x;
+    frame.scaleY = parent.scaleY * scale.y;
+    return frame;
+}
+
+bool SceneIndex::Frame::operator==(const Frame& other) const {
+    return x == other.x && y == other.y && angle == other.angle && scaleX == other.scaleX && scaleY == other.scaleY;
+}
+
+bool SceneIndex::updateFrame(const Entity* key, Record& record) {
+    auto frame = record.parent != nullptr ? m_records.at(record.parent).frame : Frame();
+    auto transform = record.transform.lock();
+    if (transform != nullptr)
+        frame = compose(frame, *transform);
+    if (frame == record.frame && record.placed == (transform != nullptr))
+        return false;
+    record.frame = frame;
+    unplace(key, record);
+    place(key, record);
+    return true;
+}
+
+void SceneIndex::relocate(const Entity* key, Record& record) {
+    if (!updateFrame(key, record))
+        return;
+    for (auto childKey : record.children)
+        relocate(childKey, m_records.at(childKey));
+}
+
+void SceneIndex::relocateAll(const Entity* key, Record& record) {
+    updateFrame(key, record);
+    for (auto childKey : record.children)
+        relocateAll(childKey, m_records.at(childKey));
+}
+
+void SceneIndex::indexComponents(const Entity* key, Record& record, const SceneNode& node) {
+    for (const auto& component : node.components) {
+        if (component == nullptr)
+            continue;
+        auto typeName = component->componentId().name();
+        if (std::find(record.typeNames.begin(), record.typeNames.end(), typeName) == record.typeNames.end()) {
+            m_entitiesByType[typeName].emplace(key, record.entity);
+            record.typeNames.push_back(std::move(typeName));
+        }
+        if (record.transform.expired()) {
+            if (auto transform = std::dynamic_pointer_cast<TransformComponent>(component))
+                record.transform = transform;
+        }
+    }
+}
+
+void SceneIndex::unindexComponents(const Entity* key, Record& record) {
+    for (const auto& typeName : record.typeNames) {
+        auto typeIter = m_entitiesByType.find(typeName);
+        if (typeIter == m_entitiesByType.end())
+            continue;
+        typeIter->second.erase(key);
+        if (typeIter->second.empty())
+            m_entitiesByType.erase(typeIter);
+    }
+    record.typeNames.clear();
+    record.transform.reset();
+}
+
+void SceneIndex::place(const Entity* key, Record& record) {
+    if (record.transform.expired() || record.placed)
+        return;
+    record.cell = cellKey(record.frame.x, record.frame.y);
+    record.placed = true;
+    m_cells[record.cell].push_back(key);
+}
+
+void SceneIndex::unplace(const Entity* key, Record& record) {
+    if (!record.placed)
+        return;
+    record.placed = false;
+    auto cellIter = m_cells.find(record.cell);
+    if (cellIter == m_cells.end())
+        return;
+    auto& keys = cellIter->second;
+    auto keyIter = std::find(keys.begin(), keys.end(), key);
+    if (keyIter != keys.end()) {
+        *keyIter = keys.back();
+        keys.pop_back();
+    }
+    if (keys.empty())
+        m_cells.erase(cellIter);
+}
+
+SceneIndex::EntityList SceneIndex::entitiesWith(const std::string& typeName) const {
+    EntityList entities;
+    auto typeIter = m_entitiesByType.find(typeName);
+    if (typeIter == m_entitiesByType.end())
+        return entities;
+    entities.reserve(typeIter->second.size());
+    for (const auto& entityPair : typeIter->second) {
+        if (auto entity = entityPair.second.lock())
+            entities.push_back(std::move(entity));
+    }
+    return entities;
+}
+
+size_t SceneIndex::countWith(const std::string& typeName) const {
+    auto typeIter = m_entitiesByType.find(typeName);
+    return typeIter == m_entitiesByType.end() ? 0 : typeIter->second.size();
+}
+
+template <typename Visit>
+void SceneIndex::visitCells(float minX, float minY, float maxX, float maxY, Visit visit) const {
+    // 64 bit, so the loops below can step past the last int32 cell
+    int64_t firstX = cellCoordinate(minX, m_cellSize);
+    int64_t firstY = cellCoordinate(minY, m_cellSize);
+    int64_t lastX = cellCoordinate(maxX, m_cellSize);
+    int64_t lastY = cellCoordinate(maxY, m_cellSize);
+    if (lastX < firstX || lastY < firstY)
+        return;
+    // A rect covering more cells than there are occupied ones scans them all
+    if (static_cast<double>(lastX - firstX + 1) * static_cast<double>(lastY - firstY + 1) > static_cast<double>(m_cells.size())) {
+        for (const auto& cellPair : m_cells) {
+            for (auto key : cellPair.second)
+                visit(key, m_records.at(key));
+        }
+        return;
+    }
+    for (auto cellX = firstX; cellX <= lastX; cellX++) {
+        for (auto cellY = firstY; cellY <= lastY; cellY++) {
+            auto cellIter = m_cells.find(packCell(static_cast<int32_t>(cellX), static_cast<int32_t>(cellY)));
+            if (cellIter == m_cells.end())
+                continue;
+            for (auto key : cellIter->second)
+                visit(key, m_records.at(key));
+        }
+    }
+}
+
+SceneIndex::EntityList SceneIndex::pick(float x, float y, float radius) const {
+    std::vector<std::pair<float, const Entity*>> hits;
+    auto radiusSquared = radius * radius;
+    visitCells(x - radius, y - radius, x + radius, y + radius, [&](const Entity* key, const Record& record) {
+        auto dx = record.frame.x - x;
+        auto dy = record.frame.y - y;
+        auto distanceSquared = dx * dx + dy * dy;
+        if (distanceSquared <= radiusSquared)
+            hits.emplace_back(distanceSquared, key);
+    });
+    std::sort(hits.begin(), hits.end());
+    EntityList entities;
+    entities.reserve(hits.size());
+    for (const auto& hit : hits) {
+        if (auto entity = m_records.at(hit.second).entity.lock())
+            entities.push_back(std::move(entity));
+    }
+    return entities;
+}
+
+SceneIndex::EntityList SceneIndex::entitiesInRect(float minX, float minY, float maxX, float maxY) const {
+    EntityList entities;
+    visitCells(minX, minY, maxX, maxY, [&](const Entity*, const Record& record) {
+        if (record.frame.x < minX || record.frame.x > maxX || record.frame.y < minY || record.frame.y > maxY)
+            return;
+        if (auto entity = record.entity.lock())
+            entities.push_back(std::move(entity));
+    });
+    return entities;
+}
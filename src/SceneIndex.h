@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Entity.h>
+#include <TransformComponent.h>
+
+#include "SceneNode.h"
+
+/// Lookups over a scene tree without walking it: entities by component type
+/// and entities by position. Positions are world positions, the
+/// TransformComponent of an entity composed with the ones of its ancestors,
+/// bucketed into a uniform grid of square cells.
+///
+/// The index is kept up to date by ProjectManager as the tree is loaded and
+/// edited. Components moving entities on their own aren't tracked, call
+/// updatePositions() before a query relying on them.
+class SceneIndex {
+public:
+    using EntityList = std::vector<std::shared_ptr<flappy::Entity>>;
+
+    /// Cells are best sized around the extent of a typical entity. A size
+    /// that isn't positive and finite throws std::invalid_argument.
+    explicit SceneIndex(float cellSize = 64.0f);
+
+    void setCellSize(float cellSize);
+
+    void rebuild(const SceneNode& root);
+    void clear();
+
+    /// The entity and its subtree, parent is already indexed
+    void addEntity(const SceneNode& parent, const SceneNode& node);
+    void removeEntity(const SceneNode& node);
+    /// Components of the entity were added, removed or replaced
+    void updateEntity(const SceneNode& node);
+    /// Entity was moved, its subtree moves along
+    void updatePosition(const SceneNode& node);
+    /// Reads every transform again
+    void updatePositions();
+
+    /// typeName as in scene files, e.g. "flappy::TextComponent"
+    EntityList entitiesWith(const std::string& typeName) const;
+    size_t countWith(const std::string& typeName) const;
+
+    /// Entities placed within radius of the point, the nearest first
+    EntityList pick(float x, float y, float radius) const;
+    EntityList entitiesInRect(float minX, float minY, float maxX, float maxY) const;
+
+    size_t size() const { return m_records.size(); }
+
+private:
+    using CellKey = uint64_t;
+
+    /// World transform of an entity, the one of its parent if it has no
+    /// TransformComponent
+    struct Frame {
+        float x = 0.0f;
+        float y = 0.0f;
+        float angle = 0.0f;
+        float scaleX = 1.0f;
+        float scaleY = 1.0f;
+
+        bool operator==(const Frame& other) const;
+    };
+
+    struct Record {
+        std::weak_ptr<flappy::Entity> entity;
+        std::weak_ptr<flappy::TransformComponent> transform;
+        std::vector<std::string> typeNames;
+        const flappy::Entity* parent = nullptr;
+        std::vector<const flappy::Entity*> children;
+        Frame frame;
+        bool placed = false;
+        CellKey cell = 0;
+    };
+
+    float m_cellSize;
+    std::unordered_map<const flappy::Entity*, Record> m_records;
+    std::unordered_map<std::string, std::unordered_map<const flappy::Entity*, std::weak_ptr<flappy::Entity>>> m_entitiesByType;
+    std::unordered_map<CellKey, std::vector<const flappy::Entity*>> m_cells;
+
+    /// Frame of an entity with transform, whose parent has the frame parent
+    static Frame compose(const Frame& parent, const flappy::TransformComponent& transform);
+
+    CellKey cellKey(float x, float y) const;
+    void addSubtree(const SceneNode& node, const flappy::Entity* parentKey);
+    void removeSubtree(const SceneNode& node);
+    /// Composes the frame of the entity with the one of its parent and
+    /// places it again, returns whether the frame changed
+    bool updateFrame(const flappy::Entity* key, Record& record);
+    /// Updates frames of the subtree as far as they change
+    void relocate(const flappy::Entity* key, Record& record);
+    /// Updates frames of the whole subtree
+    void relocateAll(const flappy::Entity* key, Record& record);
+    void indexComponents(const flappy::Entity* key, Record& record, const SceneNode& node);
+    void unindexComponents(const flappy::Entity* key, Record& record);
+    void place(const flappy::Entity* key, Record& record);
+    void unplace(const flappy::Entity* key, Record& record);
+    /// Calls visit for each placed entity in cells overlapping the rect
+    template <typename Visit>
+    void visitCells(float minX, float minY, float maxX, float maxY, Visit visit) const;
+};
@@ -0,0 +1,364 @@
+#include "SceneLoader.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Prefab.h"
+#include "Property.h"
+#include "SceneArena.h"
+#include "Trace.h"
+
+using namespace flappy;
+using json = nlohmann::json;
+
+namespace SceneLoader {
+
+void setProperties(const std::shared_ptr<ComponentBase>& component, const json& jsonComponent) {
+    auto componentPointer = RTTRService::instance().toVariant(component);
+    auto componentType = componentPointer.get_type();
+    auto properties = PropertyRegistry::instance().propertyList(componentType);
+
+    // Both json keys and properties are sorted by name, so they are matched in one pass
+    size_t propertyIndex = 0;
+    for (auto fieldIter = jsonComponent.begin(); fieldIter != jsonComponent.end(); fieldIter++) {
+        if (fieldIter.key() == "type")
+            continue;
+        while (propertyIndex < properties->size() && (*properties)[propertyIndex].name() < fieldIter.key())
+            propertyIndex++;
+        if (propertyIndex == properties->size())
+            break;
+        const auto& property = (*properties)[propertyIndex];
+        if (property.name() != fieldIter.key())
+            continue;
+        try {
+            property.setValue(componentPointer, fieldIter.value());
+        } catch (const std::exception& e) {
+            LOGE("Can't parse. %s", e.what());
+        }
+    }
+}
+
+std::shared_ptr<ComponentBase> loadComponent(Entity& entity, const json& jsonComponent) {
+    try {
+        auto typeName = jsonComponent.at("type").get<std::string>();
+        LOGI("type: %s", typeName.c_str());
+        auto typeId = TypeId<ComponentBase>(typeName);
+        auto component = RTTRService::instance().createComponent(typeId);
+        if (component != nullptr) {
+            entity.addComponent(component);
+            setProperties(component, jsonComponent);
+            return component;
+        }
+    } catch (const std::exception& e) {
+        LOGE("Can't create component. %s", e.what());
+    }
+    return nullptr;
+}
+
+void addComponent(SceneNode& node, const json& jsonComponent) {
+    auto component = loadComponent(*node.entity, jsonComponent);
+    if (component == nullptr) {
+        node.unloadedComponents.resize(node.components.size());
+        node.unloadedComponents.push_back(jsonComponent);
+    }
+    node.components.push_back(std::move(component));
+}
+
+std::unique_ptr<SceneNode> loadEntity(const json& jsonEntity) {
+    if (Prefab::isInstance(jsonEntity))
+        return loadPrefabInstance(Prefab::path(jsonEntity), Prefab::overrides(jsonEntity));
+    auto node = std::make_unique<SceneNode>();
+    node->entity = makeSceneEntity();
+    auto componentsIter = jsonEntity.find("components");
+    if (componentsIter != jsonEntity.end() && componentsIter->is_array()) {
+        node->components.reserve(componentsIter->size());
+        for (const auto& jsonComponent : *componentsIter)
+            addComponent(*node, jsonComponent);
+    }
+    auto entitiesIter = jsonEntity.find("entities");
+    if (entitiesIter != jsonEntity.end() && entitiesIter->is_array()) {
+        node->children.reserve(entitiesIter->size());
+        for (const auto& nextJsonEntity : *entitiesIter) {
+            auto child = loadEntity(nextJsonEntity);
+            node->entity->addEntity(child->entity);
+            node->children.push_back(std::move(child));
+        }
+    }
+
+    return node;
+}
+
+std::unique_ptr<SceneNode> loadPrefabInstance(const std::string& prefabPath, const json& overrides) {
+    auto prefabTemplate = PrefabRegistry::instance().prefabTemplate(prefabPath);
+    auto node = loadEntity(*prefabTemplate);
+    for (const auto& jsonOverride : overrides) {
+        try {
+            auto overriddenNode = node.get();
+            auto pathIter = jsonOverride.find("entity");
+            if (pathIter != jsonOverride.end()) {
+                for (const auto& index : *pathIter)
+                    overriddenNode = overriddenNode->children.at(index.get<size_t>()).get();
+            }
+            const auto& component = overriddenNode->components.at(jsonOverride.value("component", size_t(0)));
+            if (component != nullptr)
+                setProperties(component, jsonOverride.at("values"));
+        } catch (const std::exception& e) {
+            LOGE("Can't apply override of %s. %s", prefabPath.c_str(), e.what());
+        }
+    }
+    node->prefabPath = prefabPath;
+    return node;
+}
+
+std::unique_ptr<SceneNode> loadEntity(BinaryScene::Reader& reader) {
+    BinaryScene::Reader::Nesting nesting(reader);
+    auto node = std::make_unique<SceneNode>();
+    node->entity = makeSceneEntity();
+    std::string prefabPath;
+    json overrides = json::array();
+    auto fieldCount = reader.readCount(5);
+    for (uint32_t i = 0; i < fieldCount; i++) {
+        const auto& key = reader.string(reader.readCount());
+        auto value = reader.readValue();
+        if (key == "prefab" && value.is_string())
+            prefabPath = value.get<std::string>();
+        else if (key == "overrides" && value.is_array())
+            overrides = std::move(value);
+    }
+    auto flags = reader.readByte();
+    if (flags & BinaryScene::HasComponents) {
+        auto componentCount = reader.readCount(8);
+        node->components.reserve(componentCount);
+        for (uint32_t i = 0; i < componentCount; i++) {
+            auto typeIndex = reader.readStringIndex();
+            // Only property values are materialized as json, keys are already sorted
+            json jsonComponent = json::object();
+            auto componentFieldCount = reader.readCount(5);
+            for (uint32_t j = 0; j < componentFieldCount; j++) {
+                const auto& key = reader.string(reader.readCount());
+                jsonComponent[key] = reader.readValue();
+            }
+            if (typeIndex != BinaryScene::noString)
+                jsonComponent["type"] = reader.string(typeIndex);
+            addComponent(*node, jsonComponent);
+        }
+    }
+    if (flags & BinaryScene::HasEntities) {
+        auto entityCount = reader.readCount(5);
+        node->children.reserve(entityCount);
+        for (uint32_t i = 0; i < entityCount; i++) {
+            auto child = loadEntity(reader);
+            node->entity->addEntity(child->entity);
+            node->children.push_back(std::move(child));
+        }
+    }
+    // Own components and entities of an instance are ignored
+    if (!prefabPath.empty())
+        return loadPrefabInstance(prefabPath, overrides);
+    return node;
+}
+
+std::unique_ptr<SceneNode> loadEntity(const json& jsonEntity, ThreadPool& threadPool) {
+    if (Prefab::isInstance(jsonEntity))
+        return loadPrefabInstance(Prefab::path(jsonEntity), Prefab::overrides(jsonEntity));
+    auto node = std::make_unique<SceneNode>();
+    node->entity = makeSceneEntity();
+    auto componentsIter = jsonEntity.find("components");
+    if (componentsIter != jsonEntity.end() && componentsIter->is_array()) {
+        node->components.reserve(componentsIter->size());
+        for (const auto& jsonComponent : *componentsIter)
+            addComponent(*node, jsonComponent);
+    }
+    auto entitiesIter = jsonEntity.find("entities");
+    if (entitiesIter == jsonEntity.end() || !entitiesIter->is_array())
+        return node;
+
+    // Children are split into a few chunks per worker, every chunk is a task
+    const auto& jsonEntities = *entitiesIter;
+    size_t chunkSize = std::max<size_t>(1, jsonEntities.size() / (threadPool.size() * 4));
+    // Workers create entities in the arena of the calling thread
+    auto arena = SceneArena::current();
+    auto loadChunk = [&jsonEntities, &threadPool, arena](size_t begin, size_t end) {
+        TRACE_SPAN("SceneLoader::loadChunk", "scene");
+        SceneArena::Scope arenaScope(arena);
+        std::vector<std::unique_ptr<SceneNode>> children;
+        children.reserve(end - begin);
+        for (size_t i = begin; i < end; i++)
+            children.push_back(loadEntity(jsonEntities[i], threadPool));
+        return children;
+    };
+    std::vector<std::future<std::vector<std::unique_ptr<SceneNode>>>> chunks;
+    for (size_t begin = chunkSize; begin < jsonEntities.size(); begin += chunkSize) {
+        auto end = std::min(begin + chunkSize, jsonEntities.size());
+        chunks.push_back(threadPool.submit([loadChunk, begin, end]() { return loadChunk(begin, end); }));
+    }
+    // The first chunk is loaded by the calling thread
+    auto children = loadChunk(0, std::min(chunkSize, jsonEntities.size()));
+    for (auto& chunk : chunks) {
+        auto chunkChildren = threadPool.wait(chunk);
+        std::move(chunkChildren.begin(), chunkChildren.end(), std::back_inserter(children));
+    }
+    // Subtrees are attached in order, after all of them are built
+    node->children.reserve(children.size());
+    for (auto& child : children) {
+        node->entity->addEntity(child->entity);
+        node->children.push_back(std::move(child));
+    }
+    return node;
+}
+
+/// SAX handler following the scene structure. Unknown entity fields are skipped,
+/// components and prefab overrides are collected into small json values and
+/// used when complete.
+class SceneSaxHandler {
+public:
+    std::unique_ptr<SceneNode> result() { return std::move(m_result); }
+
+    bool null() { return value(nullptr); }
+    bool boolean(bool val) { return value(val); }
+    bool number_integer(json::number_integer_t val) { return value(val); }
+    bool number_unsigned(json::number_unsigned_t val) { return value(val); }
+    bool number_float(json::number_float_t val, const std::string&) { return value(val); }
+    bool string(std::string& val) { return value(std::move(val)); }
+    template <typename BinaryT>
+    bool binary(BinaryT&) { return false; }
+
+    bool key(std::string& val) {
+        if (!m_componentStack.empty())
+            m_componentKey = std::move(val);
+        else if (!m_frames.empty() && m_frames.back().state == State::Entity)
+            m_entityKey = std::move(val);
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        if (!m_componentStack.empty()) {
+            m_componentStack.push_back(insert(json::object()));
+        } else if (m_frames.empty() || m_frames.back().state == State::EntityList) {
+            Frame frame { State::Entity, std::make_unique<SceneNode>() };
+            frame.node->entity = makeSceneEntity();
+            m_frames.push_back(std::move(frame));
+        } else if (m_frames.back().state == State::ComponentList) {
+            m_component = json::object();
+            m_componentStack.push_back(&m_component);
+        } else {
+            m_frames.push_back({ State::Skip, nullptr });
+        }
+        return true;
+    }
+
+    bool end_object() {
+        if (!m_componentStack.empty()) {
+            m_componentStack.pop_back();
+            if (m_componentStack.empty()) {
+                auto& node = *m_frames[m_frames.size() - 2].node;
+                addComponent(node, m_component);
+            }
+            return true;
+        }
+        auto frame = std::move(m_frames.back());
+        m_frames.pop_back();
+        if (frame.state != State::Entity)
+            return true;
+        // Own components and entities of an instance are ignored
+        if (!frame.prefabPath.empty())
+            frame.node = loadPrefabInstance(frame.prefabPath, frame.overrides);
+        if (m_frames.empty()) {
+            m_result = std::move(frame.node);
+        } else {
+            auto& parent = *m_frames[m_frames.size() - 2].node;
+            parent.entity->addEntity(frame.node->entity);
+            parent.children.push_back(std::move(frame.node));
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        if (!m_componentStack.empty()) {
+            m_componentStack.push_back(insert(json::array()));
+        } else if (!m_frames.empty() && m_frames.back().state == State::Entity && m_entityKey == "components") {
+            m_frames.push_back({ State::ComponentList, nullptr });
+        } else if (!m_frames.empty() && m_frames.back().state == State::Entity && m_entityKey == "entities") {
+            m_frames.push_back({ State::EntityList, nullptr });
+        } else if (!m_frames.empty() && m_frames.back().state == State::Entity && m_entityKey == "overrides") {
+            m_overrides = json::array();
+            m_componentStack.push_back(&m_overrides);
+        } else {
+            m_frames.push_back({ State::Skip, nullptr });
+        }
+        return true;
+    }
+
+    bool end_array() {
+        if (!m_componentStack.empty()) {
+            m_componentStack.pop_back();
+            // Only the overrides array is collected from its start
+            if (m_componentStack.empty())
+                m_frames.back().overrides = std::move(m_overrides);
+        } else
+            m_frames.pop_back();
+        return true;
+    }
+
+    template <typename ExceptionT>
+    bool parse_error(std::size_t, const std::string&, const ExceptionT& exception) {
+        throw std::runtime_error(exception.what());
+    }
+
+private:
+    enum class State {
+        Entity,
+        ComponentList,
+        EntityList,
+        Skip
+    };
+
+    struct Frame {
+        State state;
+        std::unique_ptr<SceneNode> node;
+        std::string prefabPath;
+        json overrides;
+    };
+
+    std::vector<Frame> m_frames;
+    std::string m_entityKey;
+    json m_component;
+    json m_overrides;
+    std::vector<json*> m_componentStack;
+    std::string m_componentKey;
+    std::unique_ptr<SceneNode> m_result;
+
+    json* insert(json&& val) {
+        auto& container = *m_componentStack.back();
+        if (container.is_object()) {
+            auto& field = container[m_componentKey];
+            field = std::move(val);
+            return &field;
+        }
+        container.push_back(std::move(val));
+        return &container.back();
+    }
+
+    bool value(json&& val) {
+        // Values outside of components and overrides don't affect the tree, except the prefab reference
+        if (!m_componentStack.empty())
+            insert(std::move(val));
+        else if (!m_frames.empty() && m_frames.back().state == State::Entity && m_entityKey == "prefab" && val.is_string())
+            m_frames.back().prefabPath = val.get<std::string>();
+        return true;
+    }
+};
+
+std::unique_ptr<SceneNode> loadEntity(std::istream& stream) {
+    SceneSaxHandler handler;
+    json::sax_parse(stream, &handler);
+    auto root = handler.result();
+    if (!root)
+        throw std::runtime_error("Scene root must be an object");
+    return root;
+}
+
+}
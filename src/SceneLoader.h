@@ -0,0 +1,42 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+
+#include <json/json.hpp>
+
+#include <Entity.h>
+
+#include "BinaryScene.h"
+#include "SceneNode.h"
+#include "ThreadPool.h"
+
+/// Creation of entity trees from the supported scene representations.
+namespace SceneLoader {
+
+void setProperties(const std::shared_ptr<flappy::ComponentBase>& component, const nlohmann::json& jsonComponent);
+
+/// Returns nullptr if the component can't be created
+std::shared_ptr<flappy::ComponentBase> loadComponent(flappy::Entity& entity, const nlohmann::json& jsonComponent);
+
+/// Appends the component to node, the json of one that can't be created is kept
+void addComponent(SceneNode& node, const nlohmann::json& jsonComponent);
+
+/// Prefab instances are created from their cached templates, see Prefab.h
+std::unique_ptr<SceneNode> loadEntity(const nlohmann::json& jsonEntity);
+
+/// Builds independent subtrees on the thread pool. Subtrees are detached
+/// until they are complete, managers reach them once the caller adds the
+/// root to the scene on the owning thread.
+std::unique_ptr<SceneNode> loadEntity(const nlohmann::json& jsonEntity, ThreadPool& threadPool);
+
+/// Throws if the template can't be loaded, a wrong override is skipped
+std::unique_ptr<SceneNode> loadPrefabInstance(const std::string& prefabPath, const nlohmann::json& overrides);
+
+std::unique_ptr<SceneNode> loadEntity(BinaryScene::Reader& reader);
+
+/// Creates entities while the json text is being parsed, without building a
+/// document. Only a single component is held as json at a time.
+std::unique_ptr<SceneNode> loadEntity(std::istream& stream);
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <json/json.hpp>
+
+#include <Entity.h>
+
+/// Child indices leading from the root to an entity, the root itself is an empty path
+using ScenePath = std::vector<size_t>;
+
+/// Json text of a value as it was last saved
+struct SavedText {
+    nlohmann::json value;
+    std::string text;
+};
+
+/// Entity tree as it is described by a scene file. Keeps components and child
+/// entities in file order, so a loaded scene can be patched without searching
+/// the live entity tree.
+struct SceneNode {
+    std::shared_ptr<flappy::Entity> entity;
+    std::vector<std::shared_ptr<flappy::ComponentBase>> components;
+    /// Json of components that couldn't be created, at their index and null
+    /// for created ones, may be shorter than components. Saved as it was read.
+    std::vector<nlohmann::json> unloadedComponents;
+    std::vector<std::unique_ptr<SceneNode>> children;
+    /// Scene the entity is an instance of (see Prefab.h), empty for a plain entity
+    std::string prefabPath;
+    /// Saved text of each component, or of the whole subtree of a prefab
+    /// instance. Dropped when the entity is edited, see ProjectManager::saveToText().
+    std::vector<SavedText> savedComponents;
+    SavedText savedInstance;
+};
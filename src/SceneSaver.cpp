@@ -0,0 +1,75 @@
+#include "SceneSaver.h"
+
+#include "ResourceCache.h"
+#include "Trace.h"
+
+SceneSaver::SceneSaver()
+    : m_thread([this]() { saverLoop(); })
+{}
+
+SceneSaver::~SceneSaver() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+void SceneSaver::save(const std::string& path, std::string text) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool replaced = false;
+        for (auto& job : m_pending) {
+            if (job.path == path) {
+                job.text = std::move(text);
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced)
+            m_pending.push_back({path, std::move(text)});
+    }
+    m_condition.notify_all();
+}
+
+void SceneSaver::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_pending.empty() && !m_writing; });
+}
+
+std::vector<SceneSaver::Result> SceneSaver::takeResults() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Result> results;
+    results.swap(m_results);
+    return results;
+}
+
+void SceneSaver::saverLoop() {
+    Tracer::instance().setThreadName("SceneSaver");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this]() { return m_stopped || !m_pending.empty(); });
+        // Nothing is lost on exit, the pending saves are written first
+        if (m_pending.empty())
+            return;
+
+        auto job = std::move(m_pending.front());
+        m_pending.erase(m_pending.begin());
+        m_writing = true;
+
+        lock.unlock();
+        auto startTime = Clock::now();
+        bool succeeded;
+        {
+            TRACE_SPAN("SceneSaver::write", "scene");
+            succeeded = writeFileAtomically(job.path, job.text);
+        }
+        Result result {job.path, succeeded, job.text.size(), Clock::now() - startTime};
+        lock.lock();
+
+        m_writing = false;
+        m_results.push_back(std::move(result));
+        m_condition.notify_all();
+    }
+}
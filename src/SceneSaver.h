@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Writes scene files on a worker thread, each one to a temporary file
+/// which is renamed over the scene, so the file is never seen half written.
+/// Saves of the same file are coalesced, only the latest text is written.
+class SceneSaver {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Result {
+        std::string path;
+        bool succeeded;
+        size_t size;
+        Clock::duration duration;
+    };
+
+    SceneSaver();
+    SceneSaver(const SceneSaver&) = delete;
+    SceneSaver& operator=(const SceneSaver&) = delete;
+    /// Pending saves are written before the thread is stopped
+    ~SceneSaver();
+
+    /// Thread safe
+    void save(const std::string& path, std::string text);
+
+    /// Blocks until every pending save is written
+    void flush();
+
+    /// Finished saves since the last call. Supposed to be polled on the editor thread.
+    std::vector<Result> takeResults();
+
+private:
+    struct Job {
+        std::string path;
+        std::string text;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<Job> m_pending;
+    bool m_writing = false;
+    bool m_stopped = false;
+    std::vector<Result> m_results;
+    std::thread m_thread;
+
+    void saverLoop();
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <json/json.hpp>
+
+/// Live property values of a loaded scene. Unlike a saved json tree it
+/// doesn't refer to the project library, so it survives a library reload.
+struct SceneSnapshot {
+    /// Property names and type names in PropertyList order
+    using Layout = std::vector<std::pair<std::string, std::string>>;
+
+    struct Component {
+        std::string typeName;
+        /// Values in the order of the type layout, null if a value can't be read
+        std::vector<nlohmann::json> values;
+    };
+
+    struct Node {
+        std::vector<Component> components;
+        std::vector<Node> children;
+    };
+
+    Node root;
+    std::unordered_map<std::string, Layout> layouts;
+};
@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < threadCount; i++)
+        m_workers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    m_stopped = true;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wakeCondition.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool threadPool;
+    return threadPool;
+}
+
+void ThreadPool::push(std::function<void()> task) {
+    auto& queue = *m_queues[m_nextQueue++ % m_queues.size()];
+    m_pendingCount++;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wakeCondition.notify_one();
+    // Workers blocked in wait() help with the new task too
+    m_doneCondition.notify_one();
+}
+
+void ThreadPool::notifyDone() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_doneCondition.notify_all();
+}
+
+bool ThreadPool::popTask(size_t queueIndex, std::function<void()>& task) {
+    {
+        auto& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_pendingCount--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < m_queues.size(); i++) {
+        auto& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_pendingCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    if (m_pendingCount == 0)
+        return false;
+    std::function<void()> task;
+    auto queueIndex = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_queues.size();
+    if (!popTask(queueIndex, task))
+        return false;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t queueIndex) {
+    Tracer::instance().setThreadName("ThreadPool " + std::to_string(queueIndex));
+    while (!m_stopped) {
+        std::function<void()> task;
+        if (popTask(queueIndex, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeCondition.wait(lock, [this]() { return m_stopped || m_pendingCount > 0; });
+    }
+}
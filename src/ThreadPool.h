@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Work-stealing thread pool. Every worker has its own queue and takes tasks
+/// from its front, idle workers steal from the back of other queues. Tasks may
+/// submit subtasks and wait for them with wait(), which runs pending tasks
+/// instead of blocking the worker and sleeps while there are none.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    /// Pool shared by the editor, created on first use
+    static ThreadPool& shared();
+
+    size_t size() const { return m_workers.size(); }
+
+    void push(std::function<void()> task);
+
+    template <typename FuncT>
+    auto submit(FuncT&& func) -> std::future<decltype(func())> {
+        using ResultT = decltype(func());
+        auto task = std::make_shared<std::packaged_task<ResultT()>>(std::forward<FuncT>(func));
+        auto future = task->get_future();
+        push([this, task]() {
+            (*task)();
+            notifyDone();
+        });
+        return future;
+    }
+
+    /// Executes one pending task on the calling thread, returns false if there was none
+    bool runPendingTask();
+
+    /// Future must come from submit() of this pool
+    template <typename ResultT>
+    ResultT wait(std::future<ResultT>& future) {
+        auto ready = [&future]() { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; };
+        while (!ready()) {
+            if (runPendingTask())
+                continue;
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_doneCondition.wait(lock, [this, &ready]() { return m_pendingCount > 0 || ready(); });
+        }
+        return future.get();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_nextQueue {0};
+    std::atomic<size_t> m_pendingCount {0};
+    std::atomic<bool> m_stopped {false};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    /// Wakes wait() when a submitted task finishes or a new one is pushed
+    std::condition_variable m_doneCondition;
+
+    void notifyDone();
+    bool popTask(size_t queueIndex, std::function<void()>& task);
+    void workerLoop(size_t queueIndex);
+};
@@ -0,0 +1,158 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
+
+using json = nlohmann::json;
+
+Tracer::ThreadBuffer::~ThreadBuffer() {
+    auto block = first.load();
+    while (block != nullptr) {
+        auto next = block->next.load();
+        delete block;
+        block = next;
+    }
+}
+
+Tracer::Tracer()
+    : m_epoch(std::chrono::steady_clock::now())
+{}
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+uint64_t Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+Tracer::ThreadBuffer& Tracer::threadBuffer() {
+    // Buffers are owned by the tracer and outlive their threads
+    static thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        auto newBuffer = std::make_unique<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        newBuffer->threadId = static_cast<uint32_t>(m_buffers.size() + 1);
+        buffer = newBuffer.get();
+        m_buffers.push_back(std::move(newBuffer));
+    }
+    return *buffer;
+}
+
+void Tracer::record(const char* name, const char* category, uint64_t start, uint64_t end) {
+    auto& buffer = threadBuffer();
+    auto block = buffer.last;
+    auto index = block != nullptr ? block->count.load(std::memory_order_relaxed) : blockSize;
+    if (index == blockSize) {
+        if (buffer.blockCount == maxBlocksPerThread) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto newBlock = new Block();
+        if (block != nullptr)
+            block->next.store(newBlock, std::memory_order_release);
+        else
+            buffer.first.store(newBlock, std::memory_order_release);
+        buffer.last = block = newBlock;
+        buffer.blockCount++;
+        index = 0;
+    }
+    block->events[index] = {name, category, start, end - start};
+    block->count.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(const std::string& name) {
+    auto& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer.threadName = name;
+}
+
+uint64_t Tracer::droppedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t dropped = 0;
+    for (const auto& buffer : m_buffers)
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+bool Tracer::exportChromeTrace(const std::string& path, const json& otherData) const {
+    auto jsonEvents = json::array();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& buffer : m_buffers) {
+            if (!buffer->threadName.empty()) {
+                jsonEvents.push_back({
+                    {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->threadId},
+                    {"args", {{"name", buffer->threadName}}}
+                });
+            }
+            for (auto block = buffer->first.load(std::memory_order_acquire); block != nullptr; block = block->next.load(std::memory_order_acquire)) {
+                auto count = block->count.load(std::memory_order_acquire);
+                for (size_t i = 0; i < count; i++) {
+                    const auto& event = block->events[i];
+                    // Microseconds with fractions, as the format expects
+                    jsonEvents.push_back({
+                        {"name", event.name}, {"cat", event.category}, {"ph", "X"},
+                        {"ts", event.start / 1000.0}, {"dur", event.duration / 1000.0},
+                        {"pid", 1}, {"tid", buffer->threadId}
+                    });
+                }
+            }
+        }
+    }
+    json jsonTrace = {
+        {"traceEvents", std::move(jsonEvents)},
+        {"displayTimeUnit", "ms"},
+        {"otherData", otherData}
+    };
+    std::ofstream stream(path, std::ios::trunc);
+    stream << jsonTrace.dump();
+    return static_cast<bool>(stream);
+}
+
+LatencyHistogram::LatencyHistogram(size_t window)
+    : m_window(std::max<size_t>(window, 1))
+{}
+
+void LatencyHistogram::add(std::chrono::nanoseconds latency) {
+    if (m_samples.size() < m_window) {
+        m_samples.push_back(latency);
+    } else {
+        m_samples[m_next] = latency;
+        m_next = (m_next + 1) % m_window;
+    }
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double fraction) const {
+    if (m_samples.empty())
+        return std::chrono::nanoseconds::zero();
+    auto sorted = m_samples;
+    auto index = static_cast<size_t>(std::max(0.0, std::min(1.0, fraction)) * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+std::vector<size_t> LatencyHistogram::buckets() const {
+    std::vector<size_t> result(bucketCount, 0);
+    for (auto sample : m_samples) {
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(sample).count();
+        size_t bucket = 0;
+        while (bucket + 1 < bucketCount && milliseconds >= (1ll << bucket))
+            bucket++;
+        result[bucket]++;
+    }
+    return result;
+}
+
+json LatencyHistogram::toJson() const {
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    return {
+        {"count", count()},
+        {"p50Ms", Milliseconds(percentile(0.5)).count()},
+        {"p90Ms", Milliseconds(percentile(0.9)).count()},
+        {"p99Ms", Milliseconds(percentile(0.99)).count()},
+        {"maxMs", Milliseconds(percentile(1.0)).count()},
+        {"bucketsLog2Ms", buckets()}
+    };
+}
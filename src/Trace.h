@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <json/json.hpp>
+
+/// Scoped-span tracer for the editor hot paths. Every thread writes spans to
+/// its own buffer without locking, the buffers are only read on export.
+/// When tracing is disabled a span costs one relaxed atomic load.
+class Tracer {
+public:
+    static Tracer& instance();
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    /// Nanoseconds since the tracer was created
+    uint64_t now() const;
+
+    /// name and category must be string literals, only pointers are stored
+    void record(const char* name, const char* category, uint64_t start, uint64_t end);
+
+    /// Name of the calling thread in the exported trace
+    void setThreadName(const std::string& name);
+
+    /// Spans lost because a thread buffer was full
+    uint64_t droppedCount() const;
+
+    /// Writes recorded spans in the Chrome trace event format, viewable in
+    /// chrome://tracing or Perfetto. otherData is stored next to the events.
+    bool exportChromeTrace(const std::string& path, const nlohmann::json& otherData = nlohmann::json::object()) const;
+
+private:
+    struct Event {
+        const char* name;
+        const char* category;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    static const size_t blockSize = 4096;
+    static const size_t maxBlocksPerThread = 256;
+
+    /// Filled by the owning thread, count is published after the event is written
+    struct Block {
+        Event events[blockSize];
+        std::atomic<size_t> count {0};
+        std::atomic<Block*> next {nullptr};
+    };
+
+    struct ThreadBuffer {
+        uint32_t threadId;
+        std::string threadName;
+        /// Allocated on the first span, naming a thread costs no block
+        std::atomic<Block*> first {nullptr};
+        Block* last = nullptr;
+        size_t blockCount = 0;
+        std::atomic<uint64_t> dropped {0};
+        ~ThreadBuffer();
+    };
+
+    Tracer();
+    ThreadBuffer& threadBuffer();
+
+    std::atomic<bool> m_enabled {false};
+    std::chrono::steady_clock::time_point m_epoch;
+    /// Guards the buffer list and thread names, not the events
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "editor")
+        : m_name(name)
+        , m_category(category)
+        , m_start(Tracer::instance().enabled() ? Tracer::instance().now() : 0)
+    {}
+
+    ~TraceSpan() {
+        if (m_start != 0)
+            Tracer::instance().record(m_name, m_category, m_start, Tracer::instance().now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* m_name;
+    const char* m_category;
+    uint64_t m_start;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+/// Traces the rest of the enclosing scope
+#define TRACE_SPAN(...) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(__VA_ARGS__)
+
+/// Latencies of the last window samples, bucketed by powers of two milliseconds
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(size_t window = 256);
+
+    void add(std::chrono::nanoseconds latency);
+    size_t count() const { return m_samples.size(); }
+    /// fraction in [0, 1], zero without samples
+    std::chrono::nanoseconds percentile(double fraction) const;
+    /// Bucket i counts latencies below 2^i ms, the last one counts the rest
+    std::vector<size_t> buckets() const;
+
+    nlohmann::json toJson() const;
+
+private:
+    static const size_t bucketCount = 16;
+
+    size_t m_window;
+    size_t m_next = 0;
+    std::vector<std::chrono::nanoseconds> m_samples;
+};
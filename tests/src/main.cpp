@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <json/json.hpp>
+
+#include "Prefab.h"
+#include "SceneDocument.h"
+
+using json = nlohmann::json;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (false)
+
+/// An edited scene is rebuilt from its document on every library reload and
+/// saved from the rebuilt tree, so instances must survive the round trip.
+static void documentKeepsPrefabReferences() {
+    char directory[] = "/tmp/flappy_editor_tests_XXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        CHECK(!"can't create a temporary directory");
+        return;
+    }
+    std::string basePath = directory;
+    std::ofstream(basePath + "/Prop.scene") << json {
+        { "components", { { { "type", "flappy::TransformComponent" }, { "angle", 0 } } } },
+        { "entities", { { { "components", { { { "type", "flappy::InternalComponent" }, { "value", 1 } } } } } } }
+    }.dump();
+    PrefabRegistry::instance().setBasePath(basePath);
+
+    json instance = {
+        { "prefab", "Prop.scene" },
+        { "overrides", { { { "entity", { 0 } }, { "component", 0 }, { "values", { { "value", 5 } } } } } }
+    };
+    json scene = { { "entities", { instance, { { "components", { { { "type", "flappy::TransformComponent" } } } } } } } };
+
+    auto document = SceneDocument::fromJson(scene);
+    CHECK(document.toJson() == scene);
+
+    // An edit outside of the instance keeps its overrides as written
+    auto edited = document.withProperty({1}, 0, "angle", 90);
+    auto reloaded = SceneDocument::fromJson(edited.toJson());
+    CHECK(reloaded.toJson()["entities"][0] == instance);
+
+    // An edit inside of the instance becomes an override
+    edited = reloaded.withProperty({0}, 0, "angle", 45);
+    auto jsonInstance = SceneDocument::fromJson(edited.toJson()).toJson()["entities"][0];
+    CHECK(jsonInstance.value("prefab", std::string()) == "Prop.scene");
+    CHECK(PrefabRegistry::instance().expand(jsonInstance)["components"][0]["angle"] == 45);
+    CHECK(PrefabRegistry::instance().expand(jsonInstance)["entities"][0]["components"][0]["value"] == 5);
+
+    PrefabRegistry::instance().setBasePath("");
+    unlink((basePath + "/Prop.scene").c_str());
+    rmdir(directory);
+}
+
+int main() {
+    documentKeepsPrefabReferences();
+    if (failures != 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}